@@ -0,0 +1,728 @@
+#include "engine.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <new>
+#include <cstdio>
+#include <sys/resource.h>
+
+using namespace textengine;
+
+// count every heap allocation made by the benchmarked code
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = std::aligned_alloc(size_t(align), (size + size_t(align) - 1) / size_t(align) * size_t(align)))
+		return p;
+	throw std::bad_alloc();
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+/**
+ * build a tree with a single dialog and a number of decisions, texts are longer than the sso buffer
+ */
+static Tree *renderTree(int decisions)
+{
+	Tree *tree = new Tree("bench", "dialog");
+	Dialog *dialog = tree->insertDialog("dialog", "the dialog message, long enough to not fit in a small string", "nextd");
+	for (int i = 0; i < decisions; i++)
+		dialog->insertDecision("decision " + std::to_string(i), "a decision message, long enough to not fit in a small string", "nextd", i % 4 != 0);
+	return tree;
+}
+
+/**
+ * render a dialog the way it was done before views: every getter copied its map or string
+ */
+static void BM_RenderCopy(benchmark::State &state)
+{
+	configure config;
+	Tree *tree = renderTree(state.range(0));
+	std::string out;
+	out.reserve(1 << 16);
+
+	size_t before = allocations.load();
+	for (auto _ : state)
+	{
+		out.clear();
+		Dialog *dialog = tree->dialog(std::string("dialog"));
+		std::string message(dialog->message());
+		out.append(message);
+		TextMap<Decision *> decisions(dialog->allDecisions());
+		for (auto const &de : decisions)
+		{
+			if (!de.second->enabled() && !config.display_disabled_decisions)
+				continue;
+			std::string decision(de.second->message());
+			out.append("\n").append(config.output_indent).append(decision);
+		}
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.counters["allocs_per_render"] = double(allocations.load() - before) / state.iterations();
+	delete tree;
+}
+BENCHMARK(BM_RenderCopy)->Arg(2)->Arg(6)->Arg(32);
+
+/**
+ * render a dialog through the const views
+ */
+static void BM_RenderView(benchmark::State &state)
+{
+	configure config;
+	Tree *tree = renderTree(state.range(0));
+	std::string out;
+	out.reserve(1 << 16);
+
+	size_t before = allocations.load();
+	for (auto _ : state)
+	{
+		out.clear();
+		const Dialog *dialog = tree->dialog("dialog");
+		out.append(dialog->message());
+		for (auto const &de : dialog->allDecisions())
+		{
+			if (!de.second->enabled() && !config.display_disabled_decisions)
+				continue;
+			out.append("\n").append(config.output_indent).append(de.second->message());
+		}
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.counters["allocs_per_render"] = double(allocations.load() - before) / state.iterations();
+	delete tree;
+}
+BENCHMARK(BM_RenderView)->Arg(2)->Arg(6)->Arg(32);
+
+/**
+ * build a tree with a number of dialogs, each with a number of decisions
+ */
+static Tree *lookupTree(int dialogs, int decisions)
+{
+	Tree *tree = new Tree("bench", "dialog 0");
+	for (int i = 0; i < dialogs; i++)
+	{
+		Dialog *dialog = tree->insertDialog("dialog " + std::to_string(i), "message", "dialog 0d");
+		for (int j = 0; j < decisions; j++)
+			dialog->insertDecision("decision " + std::to_string(j), "message");
+	}
+	return tree;
+}
+
+/**
+ * ids to look up, in random order
+ */
+static std::vector<std::string> lookupIds(const std::string &prefix, int count)
+{
+	std::vector<std::string> ids;
+	for (int i = 0; i < count; i++)
+		ids.push_back(prefix + std::to_string(i));
+	std::shuffle(ids.begin(), ids.end(), std::mt19937(42));
+	return ids;
+}
+
+/**
+ * dialog lookup by id, std::map baseline
+ */
+static void BM_DialogLookupMap(benchmark::State &state)
+{
+	Tree *tree = lookupTree(state.range(0), 0);
+	std::map<std::string, Dialog *> dialogs;
+	for (auto const &d : tree->allDialogs())
+		dialogs.insert({std::string(d.first), d.second});
+	std::vector<std::string> ids = lookupIds("dialog ", state.range(0));
+
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(dialogs.find(ids[i])->second);
+		i = i + 1 == ids.size() ? 0 : i + 1;
+	}
+	delete tree;
+}
+BENCHMARK(BM_DialogLookupMap)->Arg(8)->Arg(64)->Arg(10000)->Arg(100000);
+
+/**
+ * dialog lookup by id through Tree::dialog
+ */
+static void BM_DialogLookup(benchmark::State &state)
+{
+	Tree *tree = lookupTree(state.range(0), 0);
+	std::vector<std::string> ids = lookupIds("dialog ", state.range(0));
+
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(tree->dialog(ids[i]));
+		i = i + 1 == ids.size() ? 0 : i + 1;
+	}
+	delete tree;
+}
+BENCHMARK(BM_DialogLookup)->Arg(8)->Arg(64)->Arg(10000)->Arg(100000);
+
+/**
+ * decision lookup by id, std::map baseline
+ */
+static void BM_DecisionLookupMap(benchmark::State &state)
+{
+	Tree *tree = lookupTree(1, state.range(0));
+	std::map<std::string, Decision *> decisions;
+	for (auto const &d : tree->dialog("dialog 0")->allDecisions())
+		decisions.insert({std::string(d.first), d.second});
+	std::vector<std::string> ids = lookupIds("decision ", state.range(0));
+
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(decisions.find(ids[i])->second);
+		i = i + 1 == ids.size() ? 0 : i + 1;
+	}
+	delete tree;
+}
+BENCHMARK(BM_DecisionLookupMap)->Arg(2)->Arg(6)->Arg(16);
+
+/**
+ * decision lookup by id through Dialog::decision
+ */
+static void BM_DecisionLookup(benchmark::State &state)
+{
+	Tree *tree = lookupTree(1, state.range(0));
+	const Dialog *dialog = tree->dialog("dialog 0");
+	std::vector<std::string> ids = lookupIds("decision ", state.range(0));
+
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(dialog->decision(ids[i]));
+		i = i + 1 == ids.size() ? 0 : i + 1;
+	}
+	delete tree;
+}
+BENCHMARK(BM_DecisionLookup)->Arg(2)->Arg(6)->Arg(16);
+
+/**
+ * iterate over all dialogs and their decisions, std::map baseline
+ */
+static void BM_IterateMap(benchmark::State &state)
+{
+	Tree *tree = lookupTree(state.range(0), 4);
+	std::map<std::string, std::map<std::string, Decision *>> dialogs;
+	for (auto const &d : tree->allDialogs())
+		for (auto const &de : d.second->allDecisions())
+			dialogs[std::string(d.first)].insert({std::string(de.first), de.second});
+
+	for (auto _ : state)
+	{
+		int score = 0;
+		for (auto const &d : dialogs)
+			for (auto const &de : d.second)
+				score += de.second->score();
+		benchmark::DoNotOptimize(score);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0) * 4);
+	delete tree;
+}
+BENCHMARK(BM_IterateMap)->Arg(64)->Arg(10000);
+
+/**
+ * iterate over all dialogs and their decisions
+ */
+static void BM_Iterate(benchmark::State &state)
+{
+	Tree *tree = lookupTree(state.range(0), 4);
+
+	for (auto _ : state)
+	{
+		int score = 0;
+		for (auto const &d : tree->allDialogs())
+			for (auto const &de : d.second->allDecisions())
+				score += de.second->score();
+		benchmark::DoNotOptimize(score);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0) * 4);
+	delete tree;
+}
+BENCHMARK(BM_Iterate)->Arg(64)->Arg(10000);
+
+/**
+ * shape of a synthetic story, set with --dialogs=, --decisions=, --fanout=, --line=, --markers=, --trees=
+ */
+struct Shape
+{
+	int dialogs = 10000; // dialogs per tree
+	int decisions = 4;	 // decisions per dialog
+	int fanout = 2;		 // percent of decisions linking to another tree
+	int line = 80;		 // characters of text per line
+	int markers = 5;	 // percent of words that are escapes or incomplete markers
+	int trees = 16;		 // scripts of a story
+
+	std::string describe() const
+	{
+		return "dialogs=" + std::to_string(dialogs) + " decisions=" + std::to_string(decisions) + " fanout=" + std::to_string(fanout) +
+			   " line=" + std::to_string(line) + " markers=" + std::to_string(markers) + " trees=" + std::to_string(trees);
+	}
+};
+
+static Shape shape;
+
+/**
+ * generate the script of a synthetic tree, deterministic for a given shape and tree number
+ * every dialog and decision links to a random dialog, some decisions to the first dialog of a random tree
+ * @param name prefix of the tree ids, tree i is name + i
+ */
+static std::string synthesize(const Shape &_shape, int _tree, const std::string &name)
+{
+	std::mt19937 random(_tree + 1);
+	auto text = [&](std::string &out) {
+		size_t end = out.size() + _shape.line;
+		while (out.size() < end)
+		{
+			int roll = random() % 100;
+			if (roll < _shape.markers)
+				out.append(roll % 2 ? "$$[escaped] " : "$ cost ");
+			else
+				out.append("lorem ipsum ");
+		}
+	};
+
+	std::string script;
+	for (int d = 0; d < _shape.dialogs; d++)
+	{
+		script.append("- $[d").append(std::to_string(d)).append("] ");
+		text(script);
+		script.append("$D[d").append(std::to_string(random() % _shape.dialogs)).append("]\n");
+		for (int c = 0; c < _shape.decisions; c++)
+		{
+			script.append("+ $[c").append(std::to_string(c)).append("] ");
+			text(script);
+			if ((int)(random() % 100) < _shape.fanout)
+				script.append("$T[").append(name).append(std::to_string(random() % _shape.trees)).append("]\n");
+			else
+				script.append("$D[d").append(std::to_string(random() % _shape.dialogs)).append("]\n");
+		}
+	}
+	return script;
+}
+
+/**
+ * get the peak resident set size of the process, in KiB
+ */
+static double peakRss()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return double(usage.ru_maxrss);
+}
+
+/**
+ * parse a synthetic script held in memory
+ */
+static void BM_Parse(benchmark::State &state)
+{
+	configure config;
+	std::string script = synthesize(shape, 0, "tree");
+	size_t before = allocations.load();
+	for (auto _ : state)
+	{
+		Tree *tree = Parser::create(config, "tree0", script);
+		benchmark::DoNotOptimize(tree);
+		delete tree;
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * script.size());
+	state.counters["allocs_per_token"] = double(allocations.load() - before) / state.iterations() / (shape.dialogs * (1.0 + shape.decisions));
+	state.counters["peak_rss_kb"] = peakRss();
+}
+
+/**
+ * compile a parsed synthetic tree, and compare the memory of the parsed nodes with the compiled graph
+ */
+static void BM_Compile(benchmark::State &state)
+{
+	configure config;
+	Tree *tree = Parser::create(config, "tree0", synthesize(shape, 0, "tree"));
+	Footprint f = tree->footprint();
+	for (auto _ : state)
+	{
+		Graph graph(*tree);
+		f.graphBytes = graph.image().size();
+		f.graphTextBytes = graph.textSize();
+	}
+	double nodes = double(f.dialogs + f.decisions);
+	state.counters["text_bytes_per_node"] = f.textBytes / nodes;
+	state.counters["arena_bytes_per_node"] = f.arenaBytes / nodes;
+	state.counters["graph_bytes_per_node"] = f.graphBytes / nodes;
+	state.counters["graph_text_bytes_per_node"] = f.graphTextBytes / nodes;
+	delete tree;
+}
+
+/**
+ * look up the dialogs of a parsed synthetic tree by id, in random order
+ */
+static void BM_StoryDialogLookup(benchmark::State &state)
+{
+	configure config;
+	Tree *tree = Parser::create(config, "tree0", synthesize(shape, 0, "tree"));
+	std::vector<std::string> ids = lookupIds("d", shape.dialogs);
+
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(tree->dialog(ids[i]));
+		i = i + 1 == ids.size() ? 0 : i + 1;
+	}
+	state.counters["peak_rss_kb"] = peakRss();
+	delete tree;
+}
+
+/**
+ * look up the decisions of the dialogs of a parsed synthetic tree by id
+ */
+static void BM_StoryDecisionLookup(benchmark::State &state)
+{
+	configure config;
+	Tree *tree = Parser::create(config, "tree0", synthesize(shape, 0, "tree"));
+	std::vector<const Dialog *> dialogs;
+	for (auto const &d : tree->allDialogs())
+		dialogs.push_back(d.second);
+	std::shuffle(dialogs.begin(), dialogs.end(), std::mt19937(42));
+	std::vector<std::string> ids = lookupIds("c", shape.decisions);
+
+	size_t i = 0, j = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(dialogs[i]->decision(ids[j]));
+		i = i + 1 == dialogs.size() ? 0 : i + 1;
+		j = j + 1 == ids.size() ? 0 : j + 1;
+	}
+	state.counters["peak_rss_kb"] = peakRss();
+	delete tree;
+}
+
+/**
+ * synthetic story written to a temporary directory, removed at exit
+ */
+struct Story
+{
+	std::string directory;
+	std::vector<std::string> files;
+
+	Story()
+	{
+		char path[] = "/tmp/textengine-bench-XXXXXX";
+		if (mkdtemp(path) == nullptr)
+			throw exception("cannot create a temporary directory");
+		directory = path;
+		for (int t = 0; t < shape.trees; t++)
+		{
+			files.push_back(directory + "/tree" + std::to_string(t));
+			std::ofstream(files.back()) << synthesize(shape, t, directory + "/tree");
+		}
+	}
+
+	~Story()
+	{
+		for (auto const &f : files)
+			std::remove(f.c_str());
+		rmdir(directory.c_str());
+	}
+};
+
+/**
+ * random walks through a synthetic story, items are steps
+ * @param range(0) number of threads, 0 = hardware concurrency
+ */
+static void BM_Run(benchmark::State &state)
+{
+	Story story;
+	Engine engine;
+	engine.parseScriptFiles(story.files);
+
+	uint64_t steps = 0;
+	for (auto _ : state)
+		steps += engine.run(story.files.front(), 1000, RandomPolicy(), 1000, steps, (unsigned)state.range(0)).steps;
+	state.SetItemsProcessed(int64_t(steps));
+	state.counters["peak_rss_kb"] = peakRss();
+}
+
+/**
+ * random walks through a synthetic story while their steps are recorded, items are steps, compare with BM_Run
+ * the steps are drained after every run, outside of the timing
+ * @param range(0) number of threads, 0 = hardware concurrency
+ */
+static void BM_Record(benchmark::State &state)
+{
+	Story story;
+	Engine engine;
+	engine.parseScriptFiles(story.files);
+	Recorder recorder;
+	engine.record(&recorder);
+
+	uint64_t steps = 0;
+	std::vector<Record> records;
+	for (auto _ : state)
+	{
+		RunStats stats = engine.run(story.files.front(), 1000, RandomPolicy(), 1000, steps, (unsigned)state.range(0));
+		steps += stats.steps;
+		state.SetIterationTime(stats.seconds); // the run only, not the drain
+		records.clear();
+		recorder.drain(records);
+	}
+	state.SetItemsProcessed(int64_t(steps));
+	state.counters["peak_rss_kb"] = peakRss();
+}
+
+/**
+ * replay the recorded steps of random walks as fast as possible, items are steps
+ * @param range(0) number of threads, 0 = hardware concurrency
+ */
+static void BM_Replay(benchmark::State &state)
+{
+	Story story;
+	Engine engine;
+	engine.parseScriptFiles(story.files);
+	Recorder recorder;
+	engine.record(&recorder);
+	engine.run(story.files.front(), 10000, RandomPolicy(), 1000);
+	engine.record(nullptr);
+	std::vector<Record> records;
+	recorder.drain(records);
+	std::string log;
+	engine.saveLog(records, log);
+
+	uint64_t steps = 0;
+	for (auto _ : state)
+		steps += engine.replay(records, 0, (unsigned)state.range(0)).steps;
+	state.SetItemsProcessed(int64_t(steps));
+	state.counters["log_bytes_per_step"] = records.empty() ? 0 : double(log.size()) / records.size();
+	state.counters["peak_rss_kb"] = peakRss();
+}
+
+/**
+ * search a synthetic story for the first 100 hits, indexes are built before the timing
+ * @param range(0) 0 = search messages, 1 = search ids by prefix
+ */
+static void BM_Search(benchmark::State &state)
+{
+	Story story;
+	Engine engine;
+	engine.parseScriptFiles(story.files);
+	auto begin = std::chrono::steady_clock::now();
+	engine.search("");
+	double build = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+	size_t hits = 0;
+	for (auto _ : state)
+		hits += (state.range(0) ? engine.searchId("d123", 100) : engine.search("escaped] lorem", 100)).size();
+	benchmark::DoNotOptimize(hits);
+	uint64_t bytes = 0;
+	for (uint32_t t = 0; t < engine.treeCount(); t++)
+		bytes += engine.footprint(t).indexBytes;
+	state.counters["index_build_ms"] = build;
+	state.counters["index_bytes"] = double(bytes);
+}
+
+/**
+ * endings and score ranges of every tree of a synthetic story
+ * @param range(0) number of threads, 0 = hardware concurrency
+ */
+static void BM_Outcomes(benchmark::State &state)
+{
+	Story story;
+	Engine engine;
+	engine.parseScriptFiles(story.files);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(engine.outcomes((unsigned)state.range(0)));
+	state.SetItemsProcessed(int64_t(state.iterations()) * shape.trees * shape.dialogs);
+}
+
+/**
+ * session of a synthetic story after a few steps, with some decisions toggled and a changed score
+ */
+static Session playedSession(const Engine &engine, const std::string &tree)
+{
+	Session session = engine.start(tree);
+	for (int i = 0; i < 8 && !session.done(); i++)
+	{
+		engine.enable(session, session.tree(), engine.graph(session)->firstDecision(session.dialog()), false);
+		engine.choose(session, 1);
+	}
+	session.score(0, 42);
+	return session;
+}
+
+/**
+ * render the dialogs of a synthetic story along a played session, disabled decisions hidden
+ * @param range(0) 1 = with the render cache, 0 = formatted at every render
+ */
+static void BM_Render(benchmark::State &state)
+{
+	Story story;
+	configure config;
+	config.display_disabled_decisions = false;
+	config.render_cache_budget = state.range(0) ? config.render_cache_budget : 0;
+	Engine engine(config);
+	engine.parseScriptFiles(story.files);
+
+	std::vector<Session> sessions;
+	for (Session session = playedSession(engine, story.files.front()); sessions.size() < 64 && !session.done(); engine.choose(session, 0))
+		sessions.push_back(session);
+
+	BufferSink sink;
+	Output output(&sink);
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		engine.render(sessions[i], output);
+		sink.clear();
+		i = i + 1 == sessions.size() ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * checkpoint a session after a step, the snapshot buffer is reused
+ */
+static void BM_SessionSave(benchmark::State &state)
+{
+	Story story;
+	Engine engine;
+	engine.parseScriptFiles(story.files);
+	Session session = playedSession(engine, story.files.front());
+
+	std::string snapshot;
+	for (auto _ : state)
+	{
+		snapshot.clear();
+		engine.save(session, snapshot);
+		benchmark::DoNotOptimize(snapshot.data());
+	}
+	state.counters["snapshot_bytes"] = double(snapshot.size());
+}
+
+/**
+ * resume a session from its snapshot
+ */
+static void BM_SessionRestore(benchmark::State &state)
+{
+	Story story;
+	Engine engine;
+	engine.parseScriptFiles(story.files);
+	std::string snapshot = engine.save(playedSession(engine, story.files.front()));
+
+	for (auto _ : state)
+	{
+		Session session = engine.restore(snapshot);
+		benchmark::DoNotOptimize(session.dialog());
+	}
+	state.counters["snapshot_bytes"] = double(snapshot.size());
+}
+
+/**
+ * parse a synthetic story from its files on all cores
+ */
+static void BM_LoadStory(benchmark::State &state)
+{
+	Story story;
+	size_t bytes = 0;
+	for (auto const &f : story.files)
+		bytes += MappedFile(f).view().size();
+
+	for (auto _ : state)
+	{
+		Engine engine;
+		engine.parseScriptFiles(story.files);
+		benchmark::DoNotOptimize(engine.treeCount());
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * bytes);
+	state.counters["peak_rss_kb"] = peakRss();
+}
+
+/**
+ * map a synthetic story compiled once into a story file, as every worker process would at startup
+ */
+static void BM_MapStory(benchmark::State &state)
+{
+	Story story;
+	std::string path = story.directory + "/story.bin";
+	{
+		Engine engine;
+		engine.parseScriptFiles(story.files);
+		engine.writeStoryFile(path);
+	}
+
+	for (auto _ : state)
+	{
+		Engine engine;
+		engine.loadStoryFile(path);
+		benchmark::DoNotOptimize(engine.treeCount());
+	}
+	state.SetBytesProcessed(int64_t(state.iterations()) * MappedFile(path).view().size());
+	state.counters["peak_rss_kb"] = peakRss();
+	std::remove(path.c_str());
+}
+
+/**
+ * read the story shape from the command line, the other arguments are left to google benchmark
+ */
+static void parseShape(int &argc, char **argv)
+{
+	int kept = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&](const char *flag, int &field) {
+			size_t length = std::strlen(flag);
+			if (arg.compare(0, length, flag) != 0)
+				return false;
+			field = std::max(1, std::atoi(arg.c_str() + length));
+			return true;
+		};
+		if (!value("--dialogs=", shape.dialogs) && !value("--decisions=", shape.decisions) && !value("--fanout=", shape.fanout) &&
+			!value("--line=", shape.line) && !value("--markers=", shape.markers) && !value("--trees=", shape.trees))
+			argv[kept++] = argv[i];
+	}
+	argc = kept;
+}
+
+int main(int argc, char **argv)
+{
+	parseShape(argc, argv);
+	benchmark::AddCustomContext("story", shape.describe());
+	benchmark::RegisterBenchmark("BM_Parse", BM_Parse);
+	benchmark::RegisterBenchmark("BM_Compile", BM_Compile);
+	benchmark::RegisterBenchmark("BM_StoryDialogLookup", BM_StoryDialogLookup);
+	benchmark::RegisterBenchmark("BM_StoryDecisionLookup", BM_StoryDecisionLookup);
+	benchmark::RegisterBenchmark("BM_LoadStory", BM_LoadStory)->UseRealTime();
+	benchmark::RegisterBenchmark("BM_MapStory", BM_MapStory)->UseRealTime();
+	benchmark::RegisterBenchmark("BM_Run", BM_Run)->Arg(1)->Arg(0)->UseRealTime();
+	benchmark::RegisterBenchmark("BM_Record", BM_Record)->Arg(1)->Arg(0)->UseManualTime();
+	benchmark::RegisterBenchmark("BM_Replay", BM_Replay)->Arg(1)->Arg(0)->UseRealTime();
+	benchmark::RegisterBenchmark("BM_Render", BM_Render)->Arg(1)->Arg(0);
+	benchmark::RegisterBenchmark("BM_Search", BM_Search)->Arg(0)->Arg(1);
+	benchmark::RegisterBenchmark("BM_Outcomes", BM_Outcomes)->Arg(1)->Arg(0)->UseRealTime();
+	benchmark::RegisterBenchmark("BM_SessionSave", BM_SessionSave);
+	benchmark::RegisterBenchmark("BM_SessionRestore", BM_SessionRestore);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
\ No newline at end of file
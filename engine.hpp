@@ -1,601 +1,6108 @@
-#pragma once
-#include <string>
-#include <map>
-#include <iostream>
-#include <fstream>
-
-namespace textengine
-{
-	/**
-	 * handling exception
-	 */
-	class exception : public std::exception
-	{
-	private:
-		const std::string message;
-
-	public:
-		exception(const std::string &error) : message(error) {}
-		const char *what() const noexcept { return message.c_str(); }
-	};
-
-	/**
-	 * @class config engine components: console, engine, parser...
-	 */
-	struct configure
-	{
-		/** 
-		 * console config
-		 */
-
-		// indentation for subsequent statements in console::out() function
-		// default = 2 spaces, use "" for no indent
-		std::string output_indent = "  ";
-
-		// set console log level
-		// 0 - log nothing
-		// 1 - errors only (default)
-		// 2 - errors and warnings
-		// 3 - log everything
-		int log_level = 1;
-
-		/** 
-		 * console config
-		 */
-
-		// control whether to trim the whitespaces after a marker
-		// true - all whitespaces after a marker up until a text will be trimmed (default)
-		bool trim_whitespaces_behind_markers = true;
-
-		/** 
-		 * console config
-		 */
-
-		// control whether disabled decisions will be displayed or not
-		// true - the decision is shown but cannot be chosen (default)
-		// false - the decision will not be shown and cannot be chosen
-		bool display_disabled_decisions = true;
-	};
-
-	/**
-	 * handling console i/o
-	 */
-	class console
-	{
-	private:
-		static std::string indent_; // indentation string
-		static int level_;			// log level
-
-	public:
-		/**
-		 * set console output indentation
-		 */
-		inline static void indent(const std::string &_indent) { indent_ = _indent; }
-
-		/**
-		 * set console log level
-		 * @param 0 log nothing
-		 * @param 1 errors only
-		 * @param 2 errors and warnings
-		 * @param 3 log everything
-		 */
-		inline static void level(int _level) { level_ = _level; }
-
-		/**
-		 * output function, can print any ostream compatible data types
-		 * @param arg first argument to be displayed, not indented
-		 * @param ... subsequent arguments, indented with console class indent value
-		 */
-		template <typename Arg, typename... Args>
-		static void out(Arg &&arg, Args &&... args)
-		{
-			std::cout << std::forward<Arg>(arg);
-			((std::cout << "\n"
-						<< indent_ << std::forward<Args>(args)),
-			 ...);
-			std::cout << std::endl;
-		}
-
-		/**
-		 * log to console
-		 * @param level level of logging:
-		 * @param 1 errors, will throw exception with the arg as message
-		 * @param 2 warnings
-		 * @param 3 info
-		 * @param arg first argument to be displayed, not indented
-		 * @param ... subsequent arguments, indented with console class indent value
-		 */
-		template <typename Arg, typename... Args>
-		static void log(int level, Arg &&arg, Args &&... args)
-		{
-			if (level == 1)
-				throw exception(arg);
-			else if (level < 1 || level > level_)
-				return;
-			else
-				out(arg, args...);
-		}
-	};
-
-	/**
-	 * @class decisions can be made at each dialog of the game tree
-	 */
-	class Decision
-	{
-	private:
-		const std::string id_;
-		std::string message_;
-		std::string link_; // link to another dialog or tree, the final character can be ('D', 'd', 'T', 't', corresponding to link type)
-		bool enabled_;	   // whether the decision can be chosen
-		int score_;		   // how much the decision worth
-
-	public:
-		/**
-		 * construct a choice
-		 * @param _id id of the decision
-		 * @param _message message to be displayed
-		 * @param _link link to another dialog or tree, default = null (no link)
-		 * @param _enabled whether the decision can be chosen, default = true
-		 * @param _score how much the decision worth, default = 0
-		 */
-		Decision(const std::string &_id, const std::string &_message, const std::string &_link = "", bool _enabled = true, int _score = 0)
-			: id_(_id), message_(_message), link_(_link), enabled_(_enabled), score_(_score)
-		{
-		}
-
-		/** 
-		 * get decision id
-		 */
-		inline const std::string &id() const { return id_; }
-
-		/**
-		 *  set decision message 
-		 */
-		inline void message(const std::string &_message) { message_ = _message; }
-
-		/** 
-		 * get decision message 
-		 */
-		inline std::string message() { return message_; }
-
-		/** 
-		 * set decision link
-		 */
-		inline void link(const std::string &_link) { link_ = _link; }
-
-		/**
-		 * get decision link 
-		 */
-		inline std::string link() { return link_; }
-
-		/**
-		 * set enabled status 
-		 */
-		inline void enabled(bool _enable) { enabled_ = _enable; }
-
-		/** 
-		 * get enabled status
-		 */
-		inline bool enabled() { return enabled_; }
-
-		/** 
-		 * set score
-		 */
-		inline void score(int _score) { score_ = _score; }
-
-		/** 
-		 * get score
-		 */
-		inline int score() { return score_; }
-	};
-
-	/**
-	 * @class each dialog (event) of a game tree
-	 */
-	class Dialog
-	{
-	private:
-		std::map<std::string, Decision *> decisions_;
-		const std::string id_;
-		std::string message_;
-		std::string link_; // link to another dialog or tree
-
-	public:
-		/**
-		 * create a new dialog
-		 * @param _id id of the dialog
-		 * @param _message message to be displayed
-		 * @param _link link to another dialog or another tree, default = null (no link)
-		 */
-		Dialog(const std::string &_id, const std::string &_message, const std::string &_link = "")
-			: id_(_id), message_(_message), link_(_link)
-		{
-		}
-
-		/** 
-		 * get dialog id
-		 */
-		inline const std::string &id() const { return id_; }
-
-		/**
-		 * set dialog message
-		 */
-		inline void message(const std::string &_message) { message_ = _message; }
-
-		/** 
-		 * get dialog message
-		 */
-		inline std::string message() { return message_; }
-
-		/** 
-		 * set dialog link
-		 */
-		inline void link(const std::string &_link) { link_ = _link; }
-
-		/** 
-		 * get dialog link
-		 */
-		inline std::string link() { return link_; }
-
-		/**
-		 * get all decisions of the dialog
-		 */
-		inline std::map<std::string, Decision *> allDecisions() { return decisions_; }
-
-		/** 
-		 * insert a decision
-		 * @exception duplicate decision id
-		 */
-		void insertDecision(Decision *_decision)
-		{
-			if (decisions_.insert({_decision->id(), _decision}).second == false)
-				console::log(1, "duplicate decision id: " + _decision->id());
-		}
-
-		/** 
-		 * insert a decision
-		 * @param _id id of the decision
-		 * @param _message message of the decision
-		 * @param _link link of the decision to another dialog or tree, default = null (empty)
-		 * @param _enabled enabled status, default = true
-		 * @param _score how much the decision worth, default = 0
-		 * @exception duplicate decision id
-		 */
-		void insertDecision(const std::string &_id, const std::string &_message, const std::string &_link = "", bool _enabled = true, int _score = 0)
-		{
-			if (decisions_.insert({_id, new Decision(_id, _message, _link, _enabled, _score)}).second == false)
-				console::log(1, "duplicate decision id: " + _id);
-		}
-
-		/** 
-		 * get a decision with a specific id 
-		 * @exception cannot find decision with id
-		 */
-		Decision *decision(const std::string &_id)
-		{
-			auto it = decisions_.find(_id);
-			if (it == decisions_.end())
-				console::log(1, "cannot find decision with id: " + _id);
-			return it->second;
-		}
-
-		/**
-		 * destructor, delete all decisions
-		 */
-		~Dialog()
-		{
-			for (auto d : decisions_)
-				delete d.second;
-		}
-	};
-
-	/**
-	 * @class the game tree, recommend 1 tree per level, can be linked with other trees
-	 */
-	class Tree
-	{
-	private:
-		std::map<std::string, Dialog *> dialogs_; // all dialogs
-		const std::string id_;					  // id of the tree
-		const std::string root_;				  // first dialog of the tree
-		int score_;								  // current score of the tree
-
-	public:
-		/**
-		 * construct a game tree
-		 * @param _link link to the first dialog in the tree
-		 * @param _initial_score the starting score of the tree
-		 */
-		Tree(const std::string &_id, const std::string &_root, int _initial_score = 0)
-			: id_(_id), root_(_root), score_(_initial_score)
-		{
-		}
-
-		/**
-		 * insert dialog into the tree
-		 * @exception duplicate dialog id
-		 */
-		void insertDialog(Dialog *_dialog)
-		{
-			if (dialogs_.insert({_dialog->id(), _dialog}).second == false)
-				console::log(1, "duplicate dialog id: " + _dialog->id());
-		}
-
-		/** 
-		 * insert dialog into the tree
-		 * @param _id id of the dialog
-		 * @param _message message of the dialog to be displayed
-		 * @param _link link of the dialog to another dialog or tree
-		 * @exception duplicate dialog id
-		 */
-		void insertDialog(const std::string &_id, const std::string &_message, const std::string &_link = "")
-		{
-			if (dialogs_.insert({_id, new Dialog(_id, _message, _link)}).second == false)
-				console::log(1, "duplicate dialog id: " + _id);
-		}
-
-		/** 
-		 * get a dialog with a specific id 
-		 * @exception cannot find dialog with id
-		 */
-		Dialog *dialog(const std::string &_id)
-		{
-			auto it = dialogs_.find(_id);
-			if (it == dialogs_.end())
-				console::log(1, "cannot find dialog with id: " + _id);
-			return it->second;
-		}
-
-		/**
-		 * get all dialogs
-		 */
-		inline std::map<std::string, Dialog *> allDialogs()
-		{
-			return dialogs_;
-		}
-
-		/**
-		 * increment score, use negative value to decrement
-		 */
-		inline void incrementScore(int _value) { score_ += _value; }
-
-		/**
-		 * set score to a specific value
-		 */
-		inline void score(int _value) { score_ = _value; }
-
-		/**
-		 * get score
-		 */
-		inline int score() { return score_; }
-
-		/**
-		 * destructor, delete all dialogs
-		 */
-		~Tree()
-		{
-			for (auto d : dialogs_)
-				delete d.second;
-		}
-	};
-
-	/**
-	 * @class parse a data file and create a game tree
-	 */
-	class Parser
-	{
-	private:
-		static int uniqueInt;
-
-		/**
-		 * @class parsing token
-		 */
-		struct Token
-		{
-			std::string text = "";
-
-			std::string id = "";
-			std::string link = "";
-			bool isTreeLink = false;
-
-			bool hasId = false;
-			bool hasLink = false;
-		};
-
-		/**
-		 * parse a marker (id, links...)
-		 * @param line current line to be parsed
-		 * @param it reference to line iterator at the point the function is called, return the reference at the closing bracket `]`
-		 * @return the parsed marker value
-		 */
-		static std::string parseMarkerValue(const configure &config, const std::string &line, std::string::const_iterator &it)
-		{
-			// parse the marker
-			std::string marker;
-			while (++it != line.end() && *it != ']')
-				marker.push_back(*it);
-
-			// trim whitespaces after a marker (if option is enabled)
-			if (config.trim_whitespaces_behind_markers)
-				while (it != line.end() && *(it + 1) == ' ')
-					it++;
-
-			return marker;
-		}
-
-		/**
-		 * parse a line
-		 * can parse id and link (either type) anywhere in the line
-		 * @param config program configuration
-		 * @param curr current token being parsed
-		 * @param line the full text line
-		 * @param it iterator of the line
-		 */
-		static Token parseLine(const configure &config, Token &curr, int line_num, const std::string &line, std::string::const_iterator &it)
-		{
-			while (++it != line.end())
-			{
-				// if marker character `$` is found
-				if (*it == '$')
-				{
-					it++;
-					// `$[` creates id marker
-					if (*it == '[')
-					{
-						std::string id = parseMarkerValue(config, line, it);
-						if ((curr.hasId = !curr.hasId)) // basically check if hasId is false by flipping it and see if it's true
-							curr.id = id;
-						else
-							console::log(1, "line [" + std::to_string(line_num) + "]: found another id within token: " + id);
-					}
-
-					// if no link is parsed, try to parse tree and dialog marker
-					// `$T[` or `$t[` creates tree marker and `$D[` or `$d[` creates dialog marker
-					else if (*it == 'T' || *it == 't' || *it == 'D' || *it == 'd')
-					{
-						char linkType = *it;
-						it++;
-
-						// if marker is completed
-						if (*it == '[')
-						{
-							std::string link = parseMarkerValue(config, line, it) + linkType;
-
-							if ((curr.hasLink = !curr.hasLink)) // like hasId above
-								curr.link = link;
-							else
-								console::log(1, "line [" + std::to_string(line_num) + "]: found another link within token: " + link);
-
-							if (linkType == 'T' || linkType == 't')
-								curr.isTreeLink = true;
-							else
-								curr.isTreeLink = false;
-						}
-
-						// if neither is completed (not a marker), restore the text
-						else
-							curr.text.append(std::string({'$', linkType, *it}));
-					}
-
-					// if 2 `$` are found, escape the phrase
-					else if (*it == '$')
-						curr.text.push_back('$');
-
-					// if no marker is completed, restore the text
-					else
-						curr.text.append(std::string({'$', *it}));
-				}
-
-				// if not marker character, it's normal text
-				else
-					curr.text.push_back(*it);
-			}
-			return curr;
-		}
-
-		/**
-		 * post processing the dialog
-		 */
-		static Tree *processDialog(const std::string &fname, Token &curr, Tree *tree, Dialog *dialog)
-		{
-			if (!curr.hasLink)
-			{
-				curr.link = std::to_string(++uniqueInt) + 'd';
-				curr.isTreeLink = false;
-				console::log(2, "no link found, create link to dialog: " + uniqueInt);
-			}
-			dialog = new Dialog(curr.id, curr.text, curr.link);
-			std::cout << "new tree" << std::endl;
-
-			// create the tree if it's not yet created (creating the tree requiring the link to the first dialog)
-			if (tree == nullptr)
-				tree = new Tree(fname, dialog->id(), 0);
-
-			tree->insertDialog(dialog);
-			return tree;
-		}
-
-	public:
-		static Tree *create(const configure &config, const std::string &fname, std::fstream &file)
-		{
-			Tree *tree = nullptr;	  // current tree, will be created once the first dialog is successfully parsed
-			Dialog *dialog = nullptr; // current dialog
-
-			Token curr;			// current token
-			int line_num = 0;	// line num, for debugging
-			std::string line;	// current line to be parsed
-			std::string concat; // concat all lines belong to the same token
-
-			// parse till eof
-			while (getline(file, line))
-			{
-				line_num++;
-				if (line.empty()) // ignore empty lines
-					continue;
-				concat.append(line);
-
-				// peek next line and see if it's a new token or not (or eof)
-				// if true, start parsing the token
-				if (!file.good() || (char)file.peek() == '-' || (char)file.peek() == '+')
-				{
-					std::string::const_iterator it = concat.begin() + 1; // ignore the first marking character
-					while (it != concat.end() && *(it + 1) == ' ') 		 // trim whitespace
-						it++;
-
-					curr = parseLine(config, curr, line_num, concat, it);
-
-					// if current token is a dialog
-					if (concat.front() == '-')
-						tree = processDialog(fname, curr, tree, dialog);
-
-					// if currentt token is a decision, and there is a dialog to attach to
-					// therefore, all decisions parsed before the first dialog is parsed in the file will be discarded
-					else if (concat.front() == '+')
-					{
-						Decision *decision = new Decision(curr.id, curr.text, curr.link, true, 0);
-						if (dialog != nullptr)
-							dialog->insertDecision(decision);
-					}
-					else
-						console::log(2, "found a decision cannot be attached to any dialog at line " + line_num);
-				}
-			}
-			return tree;
-		}
-	};
-
-	/**
-	 * @class runtime engine
-	 */
-	class Engine
-	{
-	private:
-		std::map<std::string, Tree *> trees;
-		configure config;
-
-	public:
-		Engine() = default;
-
-		void parseScriptFile(const std::string &fname)
-		{
-			std::fstream file(fname);
-			if (!file.is_open())
-				console::log(1, "cannot open file: " + fname);
-			else
-				trees.insert({fname, Parser::create(config, fname, file)});
-		}
-
-		inline std::map<std::string, Tree *> tree() { return trees; }
-
-		~Engine()
-		{
-			for (auto t : trees)
-				delete t.second;
-		}
-	};
-} // namespace textengine
-
-// static initialization
-std::string textengine::console::indent_ = "  ";
-int textengine::console::level_ = 4;
-int textengine::Parser::uniqueInt = 3010299; // log 2, to create an unique id / link to dialog / decision
\ No newline at end of file
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// vectorized scanning of script text, 0 - scalar loops only, 1 - best instruction set the compiler targets (default)
+#ifndef TEXTENGINE_SIMD
+#define TEXTENGINE_SIMD 1
+#endif
+#if TEXTENGINE_SIMD && defined(__AVX2__)
+#include <immintrin.h>
+#elif TEXTENGINE_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#elif TEXTENGINE_SIMD && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// highest log level compiled in, logging above it is removed at compile time (errors are always kept)
+// 0 or 1 - errors only, 2 - errors and warnings, 3 - everything (default)
+#ifndef TEXTENGINE_LOG_LEVEL
+#define TEXTENGINE_LOG_LEVEL 3
+#endif
+
+// instrumentation counters, timers and latency histograms, see Metrics
+// 0 - removed at compile time (default), 1 - enabled
+#ifndef TEXTENGINE_METRICS
+#define TEXTENGINE_METRICS 0
+#endif
+
+namespace textengine
+{
+	/**
+	 * handling exception
+	 */
+	class exception : public std::exception
+	{
+	private:
+		const std::string message;
+
+	public:
+		exception(const std::string &error) : message(error) {}
+		const char *what() const noexcept { return message.c_str(); }
+	};
+
+	/**
+	 * @class config engine components: console, engine, parser...
+	 */
+	struct configure
+	{
+		/** 
+		 * console config
+		 */
+
+		// indentation for subsequent statements in console::out() function
+		// default = 2 spaces, use "" for no indent
+		std::string output_indent = "  ";
+
+		// set console log level
+		// 0 - log nothing
+		// 1 - errors only (default)
+		// 2 - errors and warnings
+		// 3 - log everything
+		int log_level = 1;
+
+		/** 
+		 * console config
+		 */
+
+		// control whether to trim the whitespaces after a marker
+		// true - all whitespaces after a marker up until a text will be trimmed (default)
+		bool trim_whitespaces_behind_markers = true;
+
+		/** 
+		 * console config
+		 */
+
+		// control whether disabled decisions will be displayed or not
+		// true - the decision is shown but cannot be chosen (default)
+		// false - the decision will not be shown and cannot be chosen
+		bool display_disabled_decisions = true;
+
+		/** 
+		 * engine config
+		 */
+
+		// memory budget of the trees loaded on demand (Engine::indexScriptFiles), in bytes of compiled graphs
+		// 0 - unlimited (default)
+		// otherwise the least recently entered trees are unloaded once the budget is exceeded
+		size_t load_budget = 0;
+
+		// memory budget of the rendered dialogs kept by Engine::render, in bytes
+		// 0 - no cache, dialogs are formatted at every render
+		// default = 4 MiB, dialogs rendered once the budget is used up are not kept
+		size_t render_cache_budget = 4 * 1024 * 1024;
+
+		// build the search index of a tree (Engine::search, Engine::searchId) as soon as its graph is added or replaced
+		// false - the first search indexes the trees that have no index yet (default)
+		// true - loading and reloading take longer, every search is fast
+		bool search_index = false;
+	};
+
+	/**
+	 * @class destination of formatted output
+	 */
+	class Sink
+	{
+	public:
+		/**
+		 * write a block of output
+		 */
+		virtual void write(std::string_view _data) = 0;
+
+		/**
+		 * push written output to its final destination, if the sink buffers it
+		 */
+		virtual void flush() {}
+
+		virtual ~Sink() = default;
+	};
+
+	/**
+	 * @class sink writing to an ostream
+	 */
+	class StreamSink : public Sink
+	{
+	private:
+		std::ostream &stream_;
+
+	public:
+		StreamSink(std::ostream &_stream) : stream_(_stream) {}
+		void write(std::string_view _data) override { stream_.write(_data.data(), _data.size()); }
+		void flush() override { stream_.flush(); }
+	};
+
+	/**
+	 * @class sink writing to a file descriptor (file, pipe, socket...), the descriptor is not owned
+	 */
+	class FdSink : public Sink
+	{
+	private:
+		int fd_;
+
+	public:
+		FdSink(int _fd) : fd_(_fd) {}
+
+		/**
+		 * @exception write error
+		 */
+		void write(std::string_view _data) override
+		{
+			while (!_data.empty())
+			{
+				ssize_t written = ::write(fd_, _data.data(), _data.size());
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written < 0)
+					throw exception("cannot write to file descriptor " + std::to_string(fd_) + ": " + std::strerror(errno));
+				_data.remove_prefix((size_t)written);
+			}
+		}
+	};
+
+	/**
+	 * @class sink collecting output in memory
+	 */
+	class BufferSink : public Sink
+	{
+	private:
+		std::string buffer_;
+
+	public:
+		void write(std::string_view _data) override { buffer_.append(_data); }
+
+		/**
+		 * get everything written so far
+		 */
+		inline std::string_view data() const { return buffer_; }
+
+		/**
+		 * discard everything written so far
+		 */
+		inline void clear() { buffer_.clear(); }
+	};
+
+	/**
+	 * @class batched output, formats into a buffer that is handed to the sink on flush()
+	 * not thread safe, use one output per thread or session
+	 */
+	class Output
+	{
+	private:
+		Sink *sink_;
+		std::string buffer_;
+		std::string indent_ = "  "; // indentation for subsequent arguments of out()
+		size_t limit_;				// buffer size that triggers a flush, bounds the memory of large outputs
+
+	public:
+		/**
+		 * format a single value into a string, strings and integers are appended directly
+		 */
+		template <typename T>
+		static void append(std::string &_buffer, const T &_value)
+		{
+			if constexpr (std::is_convertible<const T &, std::string_view>::value)
+				_buffer.append(std::string_view(_value));
+			else if constexpr (std::is_same<T, char>::value)
+				_buffer.push_back(_value);
+			else if constexpr (std::is_integral<T>::value)
+			{
+				char digits[24];
+				_buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), _value).ptr - digits);
+			}
+			else
+			{
+				std::ostringstream stream;
+				stream << _value;
+				_buffer.append(stream.str());
+			}
+		}
+
+		/**
+		 * format values into a single string
+		 */
+		template <typename... Args>
+		static std::string format(const Args &... args)
+		{
+			std::string buffer;
+			(append(buffer, args), ...);
+			return buffer;
+		}
+
+		/**
+		 * create an output
+		 * @param _sink destination of the output, not owned
+		 * @param _limit buffer size that triggers a flush, default = 64 KiB
+		 */
+		Output(Sink *_sink, size_t _limit = 64 * 1024) : sink_(_sink), limit_(_limit) { buffer_.reserve(_limit); }
+
+		Output(const Output &) = delete;
+		Output &operator=(const Output &) = delete;
+
+		/**
+		 * set indentation of out()
+		 */
+		inline void indent(std::string_view _indent) { indent_ = _indent; }
+
+		/**
+		 * change the sink, pending output is flushed to the previous sink first
+		 */
+		void sink(Sink *_sink)
+		{
+			flush();
+			sink_ = _sink;
+		}
+
+		/**
+		 * append raw text
+		 */
+		void write(std::string_view _data)
+		{
+			buffer_.append(_data);
+			if (buffer_.size() >= limit_)
+				flush();
+		}
+
+		/**
+		 * append a line, can print any ostream compatible data types
+		 * @param arg first argument to be displayed, not indented
+		 * @param ... subsequent arguments, each on a new line, indented
+		 */
+		template <typename Arg, typename... Args>
+		void out(const Arg &arg, const Args &... args)
+		{
+			append(buffer_, arg);
+			((buffer_.append("\n").append(indent_), append(buffer_, args)), ...);
+			buffer_.push_back('\n');
+			if (buffer_.size() >= limit_)
+				flush();
+		}
+
+		/**
+		 * append a line made of all arguments, can print any ostream compatible data types
+		 */
+		template <typename... Args>
+		void line(const Args &... args)
+		{
+			(append(buffer_, args), ...);
+			buffer_.push_back('\n');
+			if (buffer_.size() >= limit_)
+				flush();
+		}
+
+		/**
+		 * hand the buffered output to the sink in a single write
+		 */
+		void flush()
+		{
+			if (!buffer_.empty())
+			{
+				sink_->write(buffer_);
+				buffer_.clear();
+			}
+			sink_->flush();
+		}
+
+		/**
+		 * destructor, flush pending output
+		 */
+		~Output()
+		{
+			if (!buffer_.empty())
+				sink_->write(buffer_);
+		}
+	};
+
+	/**
+	 * handling console i/o
+	 * output is batched, call flush() at the end of a logical block (a rendered dialog, a dump...)
+	 */
+	class console
+	{
+	private:
+		static StreamSink standard_; // std::cout
+		static Output output_;		 // console output, shared by all threads
+		static std::mutex mutex_;	 // guards output_
+		static int level_;			 // log level
+
+	public:
+		/**
+		 * set console output indentation
+		 */
+		inline static void indent(const std::string &_indent)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			output_.indent(_indent);
+		}
+
+		/**
+		 * redirect console output, pending output is flushed first
+		 * @param _sink the new destination, not owned, nullptr = std::cout
+		 */
+		inline static void sink(Sink *_sink)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			output_.sink(_sink == nullptr ? &standard_ : _sink);
+		}
+
+		/**
+		 * write all pending output to the sink
+		 */
+		inline static void flush()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			output_.flush();
+		}
+
+		/**
+		 * set console log level
+		 * @param 0 log nothing
+		 * @param 1 errors only
+		 * @param 2 errors and warnings
+		 * @param 3 log everything
+		 */
+		inline static void level(int _level) { level_ = _level; }
+
+		/**
+		 * output function, can print any ostream compatible data types, buffered until flush()
+		 * @param arg first argument to be displayed, not indented
+		 * @param ... subsequent arguments, indented with console class indent value
+		 */
+		template <typename Arg, typename... Args>
+		static void out(const Arg &arg, const Args &... args)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			output_.out(arg, args...);
+		}
+
+		/**
+		 * log to console
+		 * @param level level of logging:
+		 * @param 1 errors, will throw exception with the arg as message
+		 * @param 2 warnings
+		 * @param 3 info
+		 * @param arg first argument to be displayed, not indented
+		 * @param ... subsequent arguments, indented with console class indent value
+		 */
+		template <typename Arg, typename... Args>
+		static void log(int level, Arg &&arg, Args &&... args)
+		{
+			if (level == 1)
+				throw exception(arg);
+			else if (level < 1 || level > level_ || level > TEXTENGINE_LOG_LEVEL)
+				return;
+			else
+				out(arg, args...);
+		}
+
+		/**
+		 * whether a log level is compiled in and enabled, to guard expensive log messages
+		 */
+		template <int Level>
+		inline static bool enabled() { return Level == 1 || (Level > 1 && Level <= TEXTENGINE_LOG_LEVEL && Level <= level_); }
+
+		/**
+		 * log a single line made of all arguments, formatted only if the level is enabled
+		 * levels above TEXTENGINE_LOG_LEVEL are removed at compile time, pass views and numbers so that nothing is built at the call site
+		 * @param Level level of logging:
+		 * @param 1 errors, will throw exception with the formatted line as message
+		 * @param 2 warnings
+		 * @param 3 info
+		 * @param ... parts of the line
+		 */
+		template <int Level, typename... Args>
+		static void log(const Args &... args)
+		{
+			if constexpr (Level == 1)
+				throw exception(Output::format(args...));
+			else if constexpr (Level > 1 && Level <= TEXTENGINE_LOG_LEVEL)
+			{
+				if (Level > level_)
+					return;
+				std::lock_guard<std::mutex> lock(mutex_);
+				output_.line(args...);
+			}
+		}
+	};
+
+	/**
+	 * @class diagnostics collected while loading a script, so that loading can go on after an error
+	 * errors are always kept, warnings are either kept or logged to the console right away
+	 */
+	class Diagnostics
+	{
+	public:
+		/**
+		 * @class a single diagnostic
+		 */
+		struct Entry
+		{
+			int level;			 // 1 = error, 2 = warning
+			int line;			 // line in the script, 0 if not bound to a line
+			std::string message; // description
+
+			/**
+			 * get the message with the line number
+			 */
+			std::string text() const { return line > 0 ? Output::format("line [", line, "]: ", message) : message; }
+		};
+
+	private:
+		std::vector<Entry> entries_; // all diagnostics in reporting order
+		size_t errors_ = 0;			 // number of errors
+		bool keepWarnings_;			 // keep warnings instead of logging them
+
+	public:
+		/**
+		 * @param _keep_warnings keep warnings, default = true, otherwise they go to console::log<2>
+		 */
+		Diagnostics(bool _keep_warnings = true) : keepWarnings_(_keep_warnings) {}
+
+		/**
+		 * report a diagnostic, the message is only formatted if it is kept (or logged)
+		 * @param Level 1 errors, 2 warnings
+		 * @param _line line in the script, 0 if not bound to a line
+		 * @param ... parts of the message
+		 */
+		template <int Level, typename... Args>
+		void report(int _line, const Args &... args)
+		{
+			static_assert(Level == 1 || Level == 2, "diagnostics are errors or warnings");
+			if constexpr (Level == 1)
+				errors_++;
+			else if (!keepWarnings_)
+			{
+				if (_line > 0)
+					console::log<2>("line [", _line, "]: ", args...);
+				else
+					console::log<2>(args...);
+				return;
+			}
+			entries_.push_back({Level, _line, Output::format(args...)});
+		}
+
+		/**
+		 * throw the first error, if any
+		 * @exception the first error
+		 */
+		void raise() const
+		{
+			for (auto const &e : entries_)
+				if (e.level == 1)
+					throw exception(e.text());
+		}
+
+		/**
+		 * get all diagnostics in reporting order
+		 */
+		inline const std::vector<Entry> &entries() const { return entries_; }
+
+		/**
+		 * get number of errors
+		 */
+		inline size_t errors() const { return errors_; }
+
+		/**
+		 * whether no error was reported
+		 */
+		inline bool ok() const { return errors_ == 0; }
+
+		/**
+		 * drop all diagnostics
+		 */
+		void clear()
+		{
+			entries_.clear();
+			errors_ = 0;
+		}
+	};
+
+	/**
+	 * @class process wide instrumentation: counters, time spent per loading phase and step latencies
+	 * everything compiles to nothing unless TEXTENGINE_METRICS is 1, updates are relaxed atomics
+	 */
+	class Metrics
+	{
+	public:
+		static constexpr bool enabled = TEXTENGINE_METRICS != 0;
+
+		/**
+		 * counted events
+		 */
+		enum Counter : size_t
+		{
+			tokens,			// dialogs and decisions parsed
+			markers,		// id and link markers parsed
+			dialogs,		// dialogs inserted into trees
+			decisions,		// decisions inserted into dialogs
+			lookups,		// dialog and decision lookups by id or symbol
+			misses,			// lookups that found nothing
+			allocations,	// blocks allocated by arenas
+			allocatedBytes, // bytes allocated by arenas
+			steps,			// session steps (next and choose)
+			counterCount
+		};
+
+		/**
+		 * timed phases of loading, phases can be nested (parse contains insert)
+		 */
+		enum Phase : size_t
+		{
+			io,		 // opening and mapping script files
+			parse,	 // parsing scripts
+			insert,	 // inserting dialogs and decisions into their maps
+			compile, // compiling trees into graphs
+			intern,	 // interning ids and links
+			phaseCount
+		};
+
+		/**
+		 * @class latency histogram, bucket i counts durations in [2^(i-1), 2^i) nanoseconds
+		 */
+		struct Histogram
+		{
+			static constexpr size_t buckets = 40;
+			uint64_t counts[buckets] = {};
+
+			/**
+			 * get the bucket of a duration
+			 */
+			static inline size_t bucket(uint64_t _nanos)
+			{
+				size_t b = 0;
+				while (_nanos != 0 && b + 1 < buckets)
+					_nanos >>= 1, b++;
+				return b;
+			}
+
+			/**
+			 * add a duration
+			 */
+			inline void add(uint64_t _nanos) { counts[bucket(_nanos)]++; }
+
+			/**
+			 * get number of durations
+			 */
+			uint64_t total() const
+			{
+				uint64_t total = 0;
+				for (auto c : counts)
+					total += c;
+				return total;
+			}
+		};
+
+		/**
+		 * @class copy of all metrics at one point in time
+		 */
+		struct Snapshot
+		{
+			uint64_t counters[counterCount] = {};
+			uint64_t nanos[phaseCount] = {}; // time spent per phase
+			uint64_t calls[phaseCount] = {}; // number of times each phase ran
+			Histogram steps;				 // latency of session steps
+
+			/**
+			 * get the name of a counter
+			 */
+			static const char *name(Counter _counter)
+			{
+				static const char *names[] = {"tokens", "markers", "dialogs", "decisions", "lookups", "misses", "allocations", "allocated_bytes", "steps"};
+				return names[_counter];
+			}
+
+			/**
+			 * get the name of a phase
+			 */
+			static const char *name(Phase _phase)
+			{
+				static const char *names[] = {"io", "parse", "insert", "compile", "intern"};
+				return names[_phase];
+			}
+
+			/**
+			 * format as a json object: {"enabled", "counters": {name: count}, "phases": {name: {"calls", "nanos"}}, "step_latency_ns": [[upper bound, count]...]}
+			 */
+			std::string json() const
+			{
+				std::string out = Output::format("{\"enabled\":", enabled ? "true" : "false", ",\"counters\":{");
+				for (size_t c = 0; c < counterCount; c++)
+					Output::append(out, Output::format(c ? "," : "", '"', name(Counter(c)), "\":", counters[c]));
+				out.append("},\"phases\":{");
+				for (size_t p = 0; p < phaseCount; p++)
+					Output::append(out, Output::format(p ? "," : "", '"', name(Phase(p)), "\":{\"calls\":", calls[p], ",\"nanos\":", nanos[p], '}'));
+				out.append("},\"step_latency_ns\":[");
+				bool first = true;
+				for (size_t b = 0; b < Histogram::buckets; b++)
+					if (steps.counts[b] != 0)
+					{
+						Output::append(out, Output::format(first ? "" : ",", '[', uint64_t(1) << b, ',', steps.counts[b], ']'));
+						first = false;
+					}
+				out.append("]}");
+				return out;
+			}
+		};
+
+	private:
+		static std::atomic<uint64_t> counters_[counterCount];
+		static std::atomic<uint64_t> nanos_[phaseCount];
+		static std::atomic<uint64_t> calls_[phaseCount];
+		static std::atomic<uint64_t> steps_[Histogram::buckets];
+
+		/**
+		 * @class arena upstream counting the blocks it hands out
+		 */
+		class Counting : public std::pmr::memory_resource
+		{
+		private:
+			void *do_allocate(size_t _bytes, size_t _alignment) override
+			{
+				add(allocations);
+				add(allocatedBytes, _bytes);
+				return std::pmr::new_delete_resource()->allocate(_bytes, _alignment);
+			}
+
+			void do_deallocate(void *_p, size_t _bytes, size_t _alignment) override { std::pmr::new_delete_resource()->deallocate(_p, _bytes, _alignment); }
+
+			bool do_is_equal(const std::pmr::memory_resource &_other) const noexcept override { return this == &_other; }
+		};
+
+	public:
+		/**
+		 * increment a counter
+		 */
+		static inline void add(Counter _counter, uint64_t _count = 1)
+		{
+			if constexpr (enabled)
+				counters_[_counter].fetch_add(_count, std::memory_order_relaxed);
+		}
+
+		/**
+		 * get the memory resource arenas allocate their blocks from
+		 */
+		static std::pmr::memory_resource *upstream()
+		{
+			if constexpr (enabled)
+			{
+				static Counting counting;
+				return &counting;
+			}
+			return std::pmr::get_default_resource();
+		}
+
+		/**
+		 * get the current time in nanoseconds, 0 if disabled
+		 */
+		static inline uint64_t now()
+		{
+			if constexpr (enabled)
+				return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			return 0;
+		}
+
+		/**
+		 * record one run of a phase started at _begin (from now()), see Span for scoped phases
+		 */
+		static inline void time(Phase _phase, uint64_t _begin)
+		{
+			if constexpr (enabled)
+			{
+				nanos_[_phase].fetch_add(now() - _begin, std::memory_order_relaxed);
+				calls_[_phase].fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		/**
+		 * record the latency of a session step started at _begin (from now())
+		 * @param _histogram histogram of the session
+		 */
+		static inline void step(Histogram &_histogram, uint64_t _begin)
+		{
+			if constexpr (enabled)
+			{
+				uint64_t nanos = now() - _begin;
+				_histogram.add(nanos);
+				steps_[Histogram::bucket(nanos)].fetch_add(1, std::memory_order_relaxed);
+				add(steps);
+			}
+		}
+
+		/**
+		 * @class time a phase from construction to destruction
+		 */
+		class Span
+		{
+		private:
+			Phase phase_;
+			uint64_t begin_;
+
+		public:
+			inline Span(Phase _phase) : phase_(_phase), begin_(now()) {}
+
+			Span(const Span &) = delete;
+			Span &operator=(const Span &) = delete;
+
+			inline ~Span() { time(phase_, begin_); }
+		};
+
+		/**
+		 * copy all metrics, updates made concurrently may be partially included
+		 */
+		static Snapshot snapshot()
+		{
+			Snapshot snapshot;
+			for (size_t c = 0; c < counterCount; c++)
+				snapshot.counters[c] = counters_[c].load(std::memory_order_relaxed);
+			for (size_t p = 0; p < phaseCount; p++)
+			{
+				snapshot.nanos[p] = nanos_[p].load(std::memory_order_relaxed);
+				snapshot.calls[p] = calls_[p].load(std::memory_order_relaxed);
+			}
+			for (size_t b = 0; b < Histogram::buckets; b++)
+				snapshot.steps.counts[b] = steps_[b].load(std::memory_order_relaxed);
+			return snapshot;
+		}
+
+		/**
+		 * set all metrics back to 0
+		 */
+		static void reset()
+		{
+			for (auto &c : counters_)
+				c.store(0, std::memory_order_relaxed);
+			for (size_t p = 0; p < phaseCount; p++)
+			{
+				nanos_[p].store(0, std::memory_order_relaxed);
+				calls_[p].store(0, std::memory_order_relaxed);
+			}
+			for (auto &b : steps_)
+				b.store(0, std::memory_order_relaxed);
+		}
+	};
+
+	/**
+	 * string type of story nodes, allocated from the memory resource of the node
+	 */
+	using Text = std::pmr::string;
+
+	/**
+	 * @class flat map, entries are kept contiguous in insertion order
+	 * small maps are searched linearly, an open addressing hash index is built once the map grows past linearLimit entries
+	 * @param Key an integer, or a string type comparable with std::string_view
+	 */
+	template <typename Key, typename T>
+	class FlatMap
+	{
+	public:
+		using value_type = std::pair<Key, T>;
+		using view_type = std::conditional_t<std::is_integral<Key>::value, Key, std::string_view>; // type of lookup keys
+		using iterator = typename std::pmr::vector<value_type>::iterator;
+		using const_iterator = typename std::pmr::vector<value_type>::const_iterator;
+
+		static constexpr size_t linearLimit = 8; // largest size searched without index
+		static constexpr size_t npos = SIZE_MAX;
+
+	private:
+		/**
+		 * hash index slot, linear probing
+		 */
+		struct Slot
+		{
+			uint32_t hash;
+			uint32_t index; // entry index + 1, 0 if the slot is empty
+		};
+
+		std::pmr::vector<value_type> entries_;
+		std::pmr::vector<Slot> slots_; // empty while the map is small, power of 2 size otherwise
+
+		/**
+		 * hash a lookup key
+		 */
+		static inline uint32_t hash(view_type _key)
+		{
+			if constexpr (std::is_integral<Key>::value)
+				return (uint32_t)(((uint64_t)_key * 0x9E3779B97F4A7C15ull) >> 32);
+			else
+				return (uint32_t)std::hash<std::string_view>()(_key);
+		}
+
+		/**
+		 * put an entry into the hash index, the index must have a free slot
+		 */
+		void place(size_t _index)
+		{
+			uint32_t h = hash(entries_[_index].first);
+			size_t mask = slots_.size() - 1;
+			size_t s = h & mask;
+			while (slots_[s].index != 0)
+				s = (s + 1) & mask;
+			slots_[s] = {h, (uint32_t)_index + 1};
+		}
+
+		/**
+		 * rebuild the hash index with at most half of the slots used, or drop it if the map is small
+		 */
+		void rehash()
+		{
+			slots_.clear();
+			if (entries_.size() <= linearLimit)
+				return;
+
+			size_t capacity = 16;
+			while (capacity < entries_.size() * 2)
+				capacity *= 2;
+			slots_.assign(capacity, Slot{0, 0});
+			for (size_t i = 0; i < entries_.size(); i++)
+				place(i);
+		}
+
+	public:
+		/**
+		 * create a map
+		 * @param _resource memory resource of the entries and the index, default = heap
+		 */
+		FlatMap(std::pmr::memory_resource *_resource = std::pmr::get_default_resource()) : entries_(_resource), slots_(_resource) {}
+
+		/**
+		 * find the index of an entry
+		 * @return entry index in insertion order, npos if not found
+		 */
+		size_t indexOf(view_type _key) const
+		{
+			if (slots_.empty())
+			{
+				for (size_t i = 0; i < entries_.size(); i++)
+					if (entries_[i].first == _key)
+						return i;
+				return npos;
+			}
+
+			uint32_t h = hash(_key);
+			size_t mask = slots_.size() - 1;
+			for (size_t s = h & mask;; s = (s + 1) & mask)
+			{
+				const Slot &slot = slots_[s];
+				if (slot.index == 0)
+					return npos;
+				if (slot.hash == h && entries_[slot.index - 1].first == _key)
+					return slot.index - 1;
+			}
+		}
+
+		/**
+		 * find an entry
+		 * @return iterator to the entry, end() if not found
+		 */
+		inline iterator find(view_type _key)
+		{
+			size_t i = indexOf(_key);
+			return i == npos ? entries_.end() : entries_.begin() + i;
+		}
+
+		/**
+		 * find an entry
+		 * @return iterator to the entry, end() if not found
+		 */
+		inline const_iterator find(view_type _key) const
+		{
+			size_t i = indexOf(_key);
+			return i == npos ? entries_.end() : entries_.begin() + i;
+		}
+
+		/**
+		 * count entries with a key (0 or 1)
+		 */
+		inline size_t count(view_type _key) const { return indexOf(_key) == npos ? 0 : 1; }
+
+		/**
+		 * insert an entry if the key does not exist yet, the key is constructed in place with the map allocator
+		 * @return iterator to the entry with the key, and whether the entry was inserted
+		 */
+		std::pair<iterator, bool> emplace(view_type _key, const T &_value)
+		{
+			size_t i = indexOf(_key);
+			if (i != npos)
+				return {entries_.begin() + i, false};
+
+			entries_.emplace_back(std::piecewise_construct, std::forward_as_tuple(_key), std::forward_as_tuple(_value));
+			if (slots_.size() >= entries_.size() * 2)
+				place(entries_.size() - 1);
+			else if (entries_.size() > linearLimit)
+				rehash();
+			return {entries_.end() - 1, true};
+		}
+
+		/**
+		 * erase an entry, keeps the order of the other entries, linear time
+		 * @return whether the entry was found
+		 */
+		bool erase(view_type _key)
+		{
+			size_t i = indexOf(_key);
+			if (i == npos)
+				return false;
+			entries_.erase(entries_.begin() + i);
+			rehash();
+			return true;
+		}
+
+		/**
+		 * reserve space for a number of entries
+		 */
+		inline void reserve(size_t _size) { entries_.reserve(_size); }
+
+		/**
+		 * remove all entries
+		 */
+		inline void clear()
+		{
+			entries_.clear();
+			slots_.clear();
+		}
+
+		/**
+		 * get memory resource of the map
+		 */
+		inline std::pmr::memory_resource *resource() const { return entries_.get_allocator().resource(); }
+
+		inline size_t size() const { return entries_.size(); }
+		inline bool empty() const { return entries_.empty(); }
+		inline iterator begin() { return entries_.begin(); }
+		inline iterator end() { return entries_.end(); }
+		inline const_iterator begin() const { return entries_.begin(); }
+		inline const_iterator end() const { return entries_.end(); }
+	};
+
+	/**
+	 * id keyed map of story nodes in insertion order, allocated from the memory resource of the owner
+	 */
+	template <typename T>
+	using TextMap = FlatMap<Text, T>;
+
+	/**
+	 * @class monotonic memory arena, owns all nodes and text of a tree
+	 * objects created in the arena are never destroyed one by one, all blocks are released together with the arena
+	 * therefore every object created in the arena must allocate from the arena only
+	 */
+	class Arena
+	{
+	private:
+		/**
+		 * @class upstream of the arena, counts the bytes of the blocks handed out to it
+		 */
+		class Blocks : public std::pmr::memory_resource
+		{
+		public:
+			size_t reserved = 0;
+
+		private:
+			void *do_allocate(size_t _bytes, size_t _alignment) override
+			{
+				void *p = Metrics::upstream()->allocate(_bytes, _alignment);
+				reserved += _bytes;
+				return p;
+			}
+
+			void do_deallocate(void *_p, size_t _bytes, size_t _alignment) override
+			{
+				reserved -= _bytes;
+				Metrics::upstream()->deallocate(_p, _bytes, _alignment);
+			}
+
+			bool do_is_equal(const std::pmr::memory_resource &_other) const noexcept override { return this == &_other; }
+		};
+
+		Blocks blocks_; // must be constructed before the resource using it
+		std::pmr::monotonic_buffer_resource resource_;
+		std::vector<std::pair<void *, void (*)(void *)>> adopted_; // heap objects handed over to the arena, deleted with it
+
+	public:
+		/**
+		 * create an arena
+		 * @param _block_size size of the first block, subsequent blocks grow geometrically
+		 */
+		Arena(size_t _block_size = 64 * 1024) : resource_(_block_size, &blocks_) {}
+
+		Arena(const Arena &) = delete;
+		Arena &operator=(const Arena &) = delete;
+
+		/**
+		 * get memory resource of the arena, for arena backed containers
+		 */
+		inline std::pmr::memory_resource *resource() { return &resource_; }
+
+		/**
+		 * get bytes of all blocks of the arena, used or not
+		 */
+		inline size_t reserved() const { return blocks_.reserved; }
+
+		/**
+		 * construct an object in the arena, the object will not be destroyed individually
+		 */
+		template <typename T, typename... Args>
+		T *create(Args &&... args)
+		{
+			return new (resource_.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		/**
+		 * take ownership of a heap allocated object (created with new), deleted when the arena is destroyed
+		 */
+		template <typename T>
+		void adopt(T *_object)
+		{
+			adopted_.push_back({_object, [](void *object) { delete static_cast<T *>(object); }});
+		}
+
+		/**
+		 * destructor, delete adopted objects then release all blocks
+		 */
+		~Arena()
+		{
+			for (auto &a : adopted_)
+				a.second(a.first);
+		}
+	};
+
+	/**
+	 * interned id, compares and hashes as an integer
+	 */
+	using Symbol = uint32_t;
+
+	/**
+	 * @class interned symbol table, shared by all trees of an engine
+	 * symbols are numbered from 0 in interning order, names stay valid as long as the table
+	 * safe to use from multiple threads
+	 */
+	class Symbols
+	{
+	public:
+		static constexpr Symbol none = UINT32_MAX; // no symbol
+
+	private:
+		mutable std::shared_mutex mutex_;
+		Arena arena_; // names
+		FlatMap<std::string_view, Symbol> symbols_;
+		std::vector<std::string_view> names_;
+
+	public:
+		Symbols() : arena_(16 * 1024) {}
+
+		/**
+		 * get the symbol of a name, create it if it does not exist yet
+		 */
+		Symbol intern(std::string_view _name)
+		{
+			{
+				std::shared_lock<std::shared_mutex> lock(mutex_);
+				auto it = symbols_.find(_name);
+				if (it != symbols_.end())
+					return it->second;
+			}
+
+			std::unique_lock<std::shared_mutex> lock(mutex_);
+			auto it = symbols_.find(_name);
+			if (it != symbols_.end())
+				return it->second;
+
+			char *name = static_cast<char *>(arena_.resource()->allocate(_name.size() + 1, 1));
+			std::memcpy(name, _name.data(), _name.size());
+			name[_name.size()] = '\0';
+
+			Symbol symbol = (Symbol)names_.size();
+			names_.emplace_back(name, _name.size());
+			symbols_.emplace(names_.back(), symbol);
+			return symbol;
+		}
+
+		/**
+		 * get the symbol of a name without creating it
+		 * @return the symbol, none if the name was never interned
+		 */
+		Symbol find(std::string_view _name) const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex_);
+			auto it = symbols_.find(_name);
+			return it == symbols_.end() ? none : it->second;
+		}
+
+		/**
+		 * get the name of a symbol
+		 */
+		std::string_view name(Symbol _symbol) const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex_);
+			return _symbol < names_.size() ? names_[_symbol] : std::string_view();
+		}
+
+		/**
+		 * get number of symbols
+		 */
+		size_t size() const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex_);
+			return names_.size();
+		}
+
+		/**
+		 * get the symbol of the target of a link (the link without its link type)
+		 * @return the symbol, none if there is no link
+		 */
+		Symbol internLink(std::string_view _link) { return _link.empty() ? none : intern(_link.substr(0, _link.size() - 1)); }
+	};
+
+	/**
+	 * @class decisions can be made at each dialog of the game tree
+	 */
+	class Decision
+	{
+	private:
+		const Text id_;
+		Text message_;
+		Text link_;					  // link to another dialog or tree, the final character can be ('D', 'd', 'T', 't', corresponding to link type)
+		bool enabled_;				  // whether the decision can be chosen
+		int score_;					  // how much the decision worth
+		Symbol symbol_ = Symbols::none; // interned id
+		Symbol target_ = Symbols::none; // interned link target
+
+	public:
+		/**
+		 * construct a choice
+		 * @param _id id of the decision
+		 * @param _message message to be displayed
+		 * @param _link link to another dialog or tree, default = null (no link)
+		 * @param _enabled whether the decision can be chosen, default = true
+		 * @param _score how much the decision worth, default = 0
+		 * @param _resource memory resource of the texts, default = heap
+		 */
+		Decision(std::string_view _id, std::string_view _message, std::string_view _link = "", bool _enabled = true, int _score = 0,
+				 std::pmr::memory_resource *_resource = std::pmr::get_default_resource())
+			: id_(_id, _resource), message_(_message, _resource), link_(_link, _resource), enabled_(_enabled), score_(_score)
+		{
+		}
+
+		/** 
+		 * get decision id
+		 */
+		inline const Text &id() const { return id_; }
+
+		/**
+		 * get interned id, none until the tree is interned
+		 */
+		inline Symbol symbol() const { return symbol_; }
+
+		/**
+		 * get interned link target (without link type), none if there is no link or until the tree is interned
+		 */
+		inline Symbol target() const { return target_; }
+
+		/**
+		 * intern id and link target
+		 */
+		inline void intern(Symbols &_symbols)
+		{
+			symbol_ = _symbols.intern(id_);
+			target_ = _symbols.internLink(link_);
+		}
+
+		/**
+		 *  set decision message 
+		 */
+		inline void message(std::string_view _message) { message_ = _message; }
+
+		/** 
+		 * get decision message 
+		 */
+		inline std::string_view message() const { return message_; }
+
+		/** 
+		 * set decision link, the link target has to be interned again
+		 */
+		inline void link(std::string_view _link)
+		{
+			link_ = _link;
+			target_ = Symbols::none;
+		}
+
+		/**
+		 * get decision link 
+		 */
+		inline std::string_view link() const { return link_; }
+
+		/**
+		 * set enabled status 
+		 */
+		inline void enabled(bool _enable) { enabled_ = _enable; }
+
+		/** 
+		 * get enabled status
+		 */
+		inline bool enabled() const { return enabled_; }
+
+		/** 
+		 * set score
+		 */
+		inline void score(int _score) { score_ = _score; }
+
+		/** 
+		 * get score
+		 */
+		inline int score() const { return score_; }
+
+		/**
+		 * get bytes of a text allocated outside of the text object, 0 for a text short enough to be held inline
+		 */
+		static inline size_t spilled(const Text &_text) { return _text.capacity() > Text().capacity() ? _text.capacity() + 1 : 0; }
+
+		/**
+		 * get bytes of the decision and of the texts it does not hold inline
+		 */
+		inline size_t bytes() const { return sizeof(Decision) + spilled(id_) + spilled(message_) + spilled(link_); }
+	};
+
+	/**
+	 * @class each dialog (event) of a game tree
+	 */
+	class Dialog
+	{
+	private:
+		Arena *arena_; // arena the dialog is created in, nullptr if heap allocated
+		TextMap<Decision *> decisions_;
+		const Text id_;
+		Text message_;
+		Text link_;					  // link to another dialog or tree
+		Symbol symbol_ = Symbols::none; // interned id
+		Symbol target_ = Symbols::none; // interned link target
+
+	public:
+		/**
+		 * create a new dialog
+		 * @param _id id of the dialog
+		 * @param _message message to be displayed
+		 * @param _link link to another dialog or another tree, default = null (no link)
+		 * @param _arena arena to allocate texts and decisions from, default = null (heap)
+		 */
+		Dialog(std::string_view _id, std::string_view _message, std::string_view _link = "", Arena *_arena = nullptr)
+			: arena_(_arena),
+			  decisions_(_arena ? _arena->resource() : std::pmr::get_default_resource()),
+			  id_(_id, decisions_.resource()),
+			  message_(_message, decisions_.resource()),
+			  link_(_link, decisions_.resource())
+		{
+		}
+
+		/** 
+		 * get dialog id
+		 */
+		inline const Text &id() const { return id_; }
+
+		/**
+		 * get interned id, none until the tree is interned
+		 */
+		inline Symbol symbol() const { return symbol_; }
+
+		/**
+		 * get interned link target (without link type), none if there is no link or until the tree is interned
+		 */
+		inline Symbol target() const { return target_; }
+
+		/**
+		 * intern ids and link targets of the dialog and all its decisions
+		 */
+		void intern(Symbols &_symbols)
+		{
+			symbol_ = _symbols.intern(id_);
+			target_ = _symbols.internLink(link_);
+			for (auto &d : decisions_)
+				d.second->intern(_symbols);
+		}
+
+		/**
+		 * set dialog message
+		 */
+		inline void message(std::string_view _message) { message_ = _message; }
+
+		/** 
+		 * get dialog message
+		 */
+		inline std::string_view message() const { return message_; }
+
+		/** 
+		 * set dialog link, the link target has to be interned again
+		 */
+		inline void link(std::string_view _link)
+		{
+			link_ = _link;
+			target_ = Symbols::none;
+		}
+
+		/** 
+		 * get dialog link
+		 */
+		inline std::string_view link() const { return link_; }
+
+		/**
+		 * get all decisions of the dialog
+		 */
+		inline const TextMap<Decision *> &allDecisions() const { return decisions_; }
+
+		/**
+		 * get bytes of the dialog, of its decision table and of the texts it does not hold inline, decisions excluded
+		 */
+		inline size_t bytes() const
+		{
+			return sizeof(Dialog) + decisions_.size() * sizeof(TextMap<Decision *>::value_type) + Decision::spilled(id_) + Decision::spilled(message_) +
+				   Decision::spilled(link_);
+		}
+
+		/** 
+		 * insert a heap allocated decision (created with new), the dialog takes ownership
+		 * @exception duplicate decision id
+		 */
+		void insertDecision(Decision *_decision)
+		{
+			if (decisions_.emplace(_decision->id(), _decision).second == false)
+				console::log<1>("duplicate decision id: ", _decision->id());
+			if (arena_ != nullptr)
+				arena_->adopt(_decision);
+		}
+
+		/** 
+		 * insert a decision
+		 * @param _id id of the decision
+		 * @param _message message of the decision
+		 * @param _link link of the decision to another dialog or tree, default = null (empty)
+		 * @param _enabled enabled status, default = true
+		 * @param _score how much the decision worth, default = 0
+		 * @return the new decision
+		 * @exception duplicate decision id
+		 */
+		Decision *insertDecision(std::string_view _id, std::string_view _message, std::string_view _link = "", bool _enabled = true, int _score = 0)
+		{
+			if (decisions_.find(_id) != decisions_.end())
+				console::log<1>("duplicate decision id: ", _id);
+
+			Metrics::Span span(Metrics::insert);
+			Metrics::add(Metrics::decisions);
+			Decision *decision = arena_ ? arena_->create<Decision>(_id, _message, _link, _enabled, _score, arena_->resource())
+										: new Decision(_id, _message, _link, _enabled, _score);
+			decisions_.emplace(decision->id(), decision);
+			return decision;
+		}
+
+		/** 
+		 * get a decision with a specific id 
+		 * @exception cannot find decision with id
+		 */
+		Decision *decision(std::string_view _id) const
+		{
+			Decision *d = find(_id);
+			if (!d)
+				console::log<1>("cannot find decision with id: ", _id);
+			return d;
+		}
+
+		/**
+		 * find a decision with a specific id, nullptr if there is none
+		 */
+		Decision *find(std::string_view _id) const noexcept
+		{
+			Metrics::add(Metrics::lookups);
+			auto it = decisions_.find(_id);
+			if (it == decisions_.end())
+			{
+				Metrics::add(Metrics::misses);
+				return nullptr;
+			}
+			return it->second;
+		}
+
+		/**
+		 * get a decision with a specific interned id, decisions are few so a linear search is the fastest
+		 * @exception cannot find decision with symbol
+		 */
+		Decision *decision(Symbol _symbol) const
+		{
+			Decision *d = find(_symbol);
+			if (!d)
+				console::log<1>("cannot find decision with symbol: ", _symbol);
+			return d;
+		}
+
+		/**
+		 * find a decision with a specific interned id, nullptr if there is none
+		 */
+		Decision *find(Symbol _symbol) const noexcept
+		{
+			Metrics::add(Metrics::lookups);
+			for (auto const &d : decisions_)
+				if (d.second->symbol() == _symbol)
+					return d.second;
+			Metrics::add(Metrics::misses);
+			return nullptr;
+		}
+
+		/**
+		 * destructor, delete all decisions
+		 * never called for arena dialogs, their decisions are released with the arena
+		 */
+		~Dialog()
+		{
+			if (arena_ == nullptr)
+				for (auto d : decisions_)
+					delete d.second;
+		}
+	};
+
+	/**
+	 * @class memory used by one tree, as parsed nodes and as compiled graph, see Tree::footprint() and Engine::footprint()
+	 */
+	struct Footprint
+	{
+		uint64_t dialogs = 0;
+		uint64_t decisions = 0;
+		uint64_t textBytes = 0;		 // ids, messages and links of all nodes
+		uint64_t nodeBytes = 0;		 // dialog and decision objects and the texts they do not hold inline
+		uint64_t arenaBytes = 0;	 // blocks of the tree arena, nodes, texts and maps, used or not
+		uint64_t graphBytes = 0;	 // compiled image, 0 if the graph is not loaded
+		uint64_t graphTextBytes = 0; // text section of the image, short texts are stored once
+		uint64_t indexBytes = 0;	 // search index of the graph, 0 until the tree is indexed
+		bool shared = false;		 // the graph is used in place from a compiled story, its pages are shared by every process mapping it
+
+		/**
+		 * format as a json object with the field names in snake case
+		 */
+		std::string json() const
+		{
+			return Output::format("{\"dialogs\":", dialogs, ",\"decisions\":", decisions, ",\"text_bytes\":", textBytes, ",\"node_bytes\":", nodeBytes,
+								  ",\"arena_bytes\":", arenaBytes, ",\"graph_bytes\":", graphBytes, ",\"graph_text_bytes\":", graphTextBytes,
+								  ",\"index_bytes\":", indexBytes,
+								  ",\"shared\":", shared ? "true" : "false", '}');
+		}
+	};
+
+	/**
+	 * @class the game tree, recommend 1 tree per level, can be linked with other trees
+	 */
+	class Tree
+	{
+	private:
+		static constexpr size_t blockSize = 4 * 1024; // first arena block, most scripts are small and blocks grow geometrically
+
+		Arena arena_;									 // owns all dialogs, decisions and texts of the tree, must be destroyed last
+		TextMap<Dialog *> dialogs_;						 // all dialogs
+		FlatMap<Symbol, Dialog *> index_;				 // all dialogs by interned id, filled by intern()
+		const std::string id_;							 // id of the tree
+		const std::string root_;						 // first dialog of the tree
+		int score_;										 // current score of the tree
+		Symbol symbol_ = Symbols::none;					 // interned id
+
+	public:
+		/**
+		 * construct a game tree
+		 * @param _link link to the first dialog in the tree
+		 * @param _initial_score the starting score of the tree
+		 */
+		Tree(const std::string &_id, const std::string &_root, int _initial_score = 0)
+			: arena_(blockSize), dialogs_(arena_.resource()), index_(arena_.resource()), id_(_id), root_(_root), score_(_initial_score)
+		{
+		}
+
+		/**
+		 * intern ids and link targets of the tree and all its nodes, and index the dialogs by symbol
+		 * call again after inserting dialogs or changing links
+		 */
+		void intern(Symbols &_symbols)
+		{
+			Metrics::Span span(Metrics::intern);
+			symbol_ = _symbols.intern(id_);
+			index_.clear();
+			index_.reserve(dialogs_.size());
+			for (auto &d : dialogs_)
+			{
+				d.second->intern(_symbols);
+				index_.emplace(d.second->symbol(), d.second);
+			}
+		}
+
+		/**
+		 * get interned id, none until the tree is interned
+		 */
+		inline Symbol symbol() const { return symbol_; }
+
+		/**
+		 * insert a heap allocated dialog (created with new) into the tree, the tree takes ownership
+		 * @exception duplicate dialog id
+		 */
+		void insertDialog(Dialog *_dialog)
+		{
+			if (dialogs_.emplace(_dialog->id(), _dialog).second == false)
+				console::log<1>("duplicate dialog id: ", _dialog->id());
+			arena_.adopt(_dialog);
+		}
+
+		/** 
+		 * insert dialog into the tree
+		 * @param _id id of the dialog
+		 * @param _message message of the dialog to be displayed
+		 * @param _link link of the dialog to another dialog or tree
+		 * @return the new dialog, allocated in the tree arena
+		 * @exception duplicate dialog id
+		 */
+		Dialog *insertDialog(std::string_view _id, std::string_view _message, std::string_view _link = "")
+		{
+			if (dialogs_.find(_id) != dialogs_.end())
+				console::log<1>("duplicate dialog id: ", _id);
+
+			Metrics::Span span(Metrics::insert);
+			Metrics::add(Metrics::dialogs);
+			Dialog *dialog = arena_.create<Dialog>(_id, _message, _link, &arena_);
+			dialogs_.emplace(dialog->id(), dialog);
+			return dialog;
+		}
+
+		/** 
+		 * get a dialog with a specific id 
+		 * @exception cannot find dialog with id
+		 */
+		Dialog *dialog(std::string_view _id) const
+		{
+			Dialog *d = find(_id);
+			if (!d)
+				console::log<1>("cannot find dialog with id: ", _id);
+			return d;
+		}
+
+		/** 
+		 * get a dialog with a specific interned id, the tree has to be interned
+		 * @exception cannot find dialog with symbol
+		 */
+		Dialog *dialog(Symbol _symbol) const
+		{
+			Dialog *d = find(_symbol);
+			if (!d)
+				console::log<1>("cannot find dialog with symbol: ", _symbol);
+			return d;
+		}
+
+		/**
+		 * find a dialog with a specific id, nullptr if there is none
+		 */
+		Dialog *find(std::string_view _id) const noexcept
+		{
+			Metrics::add(Metrics::lookups);
+			auto it = dialogs_.find(_id);
+			if (it == dialogs_.end())
+			{
+				Metrics::add(Metrics::misses);
+				return nullptr;
+			}
+			return it->second;
+		}
+
+		/**
+		 * find a dialog with a specific interned id, nullptr if there is none
+		 */
+		Dialog *find(Symbol _symbol) const noexcept
+		{
+			Metrics::add(Metrics::lookups);
+			auto it = index_.find(_symbol);
+			if (it == index_.end())
+			{
+				Metrics::add(Metrics::misses);
+				return nullptr;
+			}
+			return it->second;
+		}
+
+		/**
+		 * get tree id
+		 */
+		inline const std::string &id() const { return id_; }
+
+		/**
+		 * get id of the first dialog of the tree
+		 */
+		inline const std::string &root() const { return root_; }
+
+		/**
+		 * get all dialogs
+		 */
+		inline const TextMap<Dialog *> &allDialogs() const
+		{
+			return dialogs_;
+		}
+
+		/**
+		 * increment score, use negative value to decrement
+		 */
+		inline void incrementScore(int _value) { score_ += _value; }
+
+		/**
+		 * set score to a specific value
+		 */
+		inline void score(int _value) { score_ = _value; }
+
+		/**
+		 * get score
+		 */
+		inline int score() const { return score_; }
+
+		/**
+		 * get the memory used by the parsed nodes, the graph fields are left to the engine
+		 */
+		Footprint footprint() const
+		{
+			Footprint f;
+			f.arenaBytes = arena_.reserved();
+			for (auto const &d : dialogs_)
+			{
+				const Dialog &dialog = *d.second;
+				f.dialogs++;
+				f.textBytes += dialog.id().size() + dialog.message().size() + dialog.link().size();
+				f.nodeBytes += dialog.bytes();
+				for (auto const &de : dialog.allDecisions())
+				{
+					const Decision &decision = *de.second;
+					f.decisions++;
+					f.textBytes += decision.id().size() + decision.message().size() + decision.link().size();
+					f.nodeBytes += decision.bytes();
+				}
+			}
+			return f;
+		}
+	};
+
+	/**
+	 * @class compiled, index-based form of a tree used for runtime traversal
+	 * dialogs and decisions are stored in contiguous arrays (struct of arrays), links are resolved to array indices
+	 * all arrays and texts live in a single binary image, which is built from a tree or mapped from a compiled story file
+	 * the graph is a snapshot of the tree at compile time, recompile after modifying the tree
+	 */
+	class Graph
+	{
+	public:
+		static constexpr uint32_t npos = UINT32_MAX; // no target, the game ends here
+		static constexpr uint32_t version = 3;		 // version of the binary image, bump on any layout change
+
+		/**
+		 * type of a compiled link
+		 */
+		enum class LinkType : uint32_t
+		{
+			none,	// no further jump can be made
+			dialog, // target is a dialog index within this graph
+			tree,	// target is an index into the tree link table
+			missing // link to an unknown dialog, ends the game like none, target is an index into the missing link table
+		};
+
+		/**
+		 * a resolved link
+		 */
+		struct Link
+		{
+			LinkType type = LinkType::none;
+			uint32_t target = npos;
+		};
+
+	private:
+		static constexpr uint32_t targetBits = 30;						// a packed link is the link type in the top 2 bits and the target below
+		static constexpr uint32_t targetMask = (1u << targetBits) - 1;
+		static constexpr int32_t scoreLimit = 1 << 30;					// a packed decision value is the score shifted left once and the enabled bit
+
+		/**
+		 * pack a link into one word
+		 * @exception link target out of range
+		 */
+		static uint32_t pack(Link _link)
+		{
+			if (_link.type == LinkType::none)
+				return 0;
+			if (_link.target > targetMask)
+				console::log<1>("link target out of range: ", _link.target);
+			return (uint32_t)_link.type << targetBits | _link.target;
+		}
+
+		/**
+		 * unpack a link packed by pack()
+		 */
+		static inline Link unpack(uint32_t _link)
+		{
+			LinkType type = LinkType(_link >> targetBits);
+			return {type, type == LinkType::none ? npos : _link & targetMask};
+		}
+
+		/**
+		 * pack the enabled status and the score of a decision into one word
+		 * @exception score out of range
+		 */
+		static int32_t pack(bool _enabled, int _score)
+		{
+			if (_score < -scoreLimit || _score >= scoreLimit)
+				console::log<1>("decision score out of range: ", _score);
+			return (int32_t)((uint32_t)_score << 1 | (_enabled ? 1u : 0u));
+		}
+
+		/**
+		 * a text, slice of the text section
+		 */
+		struct Str
+		{
+			uint32_t offset;
+			uint32_t length;
+		};
+
+		/**
+		 * header of a binary image (native byte order)
+		 * sections follow the header at the given offsets, every section is 8 bytes aligned
+		 */
+		struct Header
+		{
+			char magic[4]; // "TEGR"
+			uint32_t version;
+			uint64_t size; // size of the whole image
+			Str id;
+			uint32_t root;
+			uint32_t dialogCount;
+			uint32_t decisionCount;
+			uint32_t treeLinkCount;
+			uint32_t missingLinkCount;
+			uint32_t reserved;
+
+			uint64_t dialogIds;		  // Str[dialogCount]
+			uint64_t dialogMessages;  // Str[dialogCount]
+			uint64_t dialogLinks;	  // uint32_t[dialogCount], packed links
+			uint64_t dialogDecisions; // uint32_t[dialogCount + 1]
+
+			uint64_t decisionIds;	   // Str[decisionCount]
+			uint64_t decisionMessages; // Str[decisionCount]
+			uint64_t decisionLinks;	   // uint32_t[decisionCount], packed links
+			uint64_t decisionValues;   // int32_t[decisionCount], packed enabled status and score
+
+			uint64_t treeLinks;	   // Str[treeLinkCount]
+			uint64_t missingLinks; // Str[missingLinkCount]
+			uint64_t text;		// char[textSize]
+			uint64_t textSize;
+		};
+
+		std::vector<uint64_t> storage_; // image built from a tree, empty if the image is borrowed
+		const Header *header_;
+
+		const Str *dialogIds_;
+		const Str *dialogMessages_;
+		const uint32_t *dialogLinks_;
+		const uint32_t *dialogDecisions_; // dialog i owns decisions [dialogDecisions_[i], dialogDecisions_[i + 1])
+
+		const Str *decisionIds_;
+		const Str *decisionMessages_;
+		const uint32_t *decisionLinks_;
+		const int32_t *decisionValues_;
+
+		const Str *treeLinks_;	  // ids of the trees linked from this graph
+		const Str *missingLinks_; // ids of the unknown dialogs linked from this graph
+		const char *text_;
+
+		std::vector<uint32_t> byId_; // dialog indices ordered by id, searched by find()
+
+		std::unique_ptr<std::atomic<uint32_t>[]> linkedTrees_; // tree index of every tree link, filled by the engine
+
+		/**
+		 * @class collects the arrays of a tree before they are laid out into an image
+		 */
+		struct Builder
+		{
+			static constexpr size_t shortText = 15; // texts up to this size (ids and links) are stored once per image
+
+			std::vector<Str> dialogIds, dialogMessages, decisionIds, decisionMessages, treeLinks, missingLinks;
+			std::vector<uint32_t> dialogLinks, decisionLinks, dialogDecisions;
+			std::vector<int32_t> decisionValues;
+			std::string text;
+			FlatMap<std::string, Str> shared; // short texts already in the text section
+
+			/**
+			 * append a text to the text section, a short text already in it is shared
+			 * @exception text section too large
+			 */
+			Str add(std::string_view _text)
+			{
+				if (_text.size() <= shortText)
+				{
+					auto it = shared.find(_text);
+					if (it != shared.end())
+						return it->second;
+				}
+				if (text.size() + _text.size() > UINT32_MAX)
+					console::log<1>("compiled tree text too large");
+
+				Str str{(uint32_t)text.size(), (uint32_t)_text.size()};
+				text.append(_text);
+				if (_text.size() <= shortText)
+					shared.emplace(_text, str);
+				return str;
+			}
+
+			/**
+			 * resolve a link string (the final character is the link type) into a dialog or tree link
+			 * @param ids dialog id to index table
+			 */
+			Link resolve(std::string_view tree, const FlatMap<std::string_view, uint32_t> &ids, std::string_view _link)
+			{
+				Link link;
+				if (_link.empty())
+					return link;
+
+				char linkType = _link.back();
+				std::string_view target = _link.substr(0, _link.size() - 1);
+				if (linkType == 'D' || linkType == 'd')
+				{
+					auto it = ids.find(target);
+					if (it == ids.end())
+					{
+						console::log<2>("tree ", tree, ": link to unknown dialog: ", target);
+						link.type = LinkType::missing;
+						link.target = (uint32_t)missingLinks.size();
+						missingLinks.push_back(add(target));
+						return link;
+					}
+					link.type = LinkType::dialog;
+					link.target = it->second;
+				}
+				else if (linkType == 'T' || linkType == 't')
+				{
+					uint32_t i = 0;
+					while (i < treeLinks.size() && std::string_view(text.data() + treeLinks[i].offset, treeLinks[i].length) != target)
+						i++;
+					if (i == treeLinks.size())
+						treeLinks.push_back(add(target));
+					link.type = LinkType::tree;
+					link.target = i;
+				}
+				return link;
+			}
+		};
+
+		/**
+		 * round up to the section alignment
+		 */
+		static inline uint64_t align(uint64_t _offset) { return (_offset + 7) & ~uint64_t(7); }
+
+		/**
+		 * copy a section into the image
+		 * @return offset of the section
+		 */
+		template <typename T>
+		static uint64_t place(std::vector<char> &image, const std::vector<T> &section)
+		{
+			uint64_t offset = align(image.size());
+			image.resize(offset + section.size() * sizeof(T));
+			if (!section.empty())
+				std::memcpy(image.data() + offset, section.data(), section.size() * sizeof(T));
+			return offset;
+		}
+
+		/**
+		 * get a section of the image
+		 */
+		template <typename T>
+		inline const T *section(uint64_t _offset) const { return reinterpret_cast<const T *>(reinterpret_cast<const char *>(header_) + _offset); }
+
+		/**
+		 * point all arrays into the image
+		 */
+		void bind()
+		{
+			dialogIds_ = section<Str>(header_->dialogIds);
+			dialogMessages_ = section<Str>(header_->dialogMessages);
+			dialogLinks_ = section<uint32_t>(header_->dialogLinks);
+			dialogDecisions_ = section<uint32_t>(header_->dialogDecisions);
+			decisionIds_ = section<Str>(header_->decisionIds);
+			decisionMessages_ = section<Str>(header_->decisionMessages);
+			decisionLinks_ = section<uint32_t>(header_->decisionLinks);
+			decisionValues_ = section<int32_t>(header_->decisionValues);
+			treeLinks_ = section<Str>(header_->treeLinks);
+			missingLinks_ = section<Str>(header_->missingLinks);
+			text_ = section<char>(header_->text);
+		}
+
+		/**
+		 * order the dialogs by id, once the arrays are bound
+		 */
+		void order()
+		{
+			byId_.resize(header_->dialogCount);
+			for (uint32_t i = 0; i < header_->dialogCount; i++)
+				byId_[i] = i;
+			std::sort(byId_.begin(), byId_.end(), [&](uint32_t a, uint32_t b) { return text(dialogIds_[a]) < text(dialogIds_[b]); });
+		}
+
+		/**
+		 * create the tree index table of the tree links, the image must be valid
+		 */
+		void unlink()
+		{
+			linkedTrees_.reset(new std::atomic<uint32_t>[header_->treeLinkCount]);
+			for (uint32_t i = 0; i < header_->treeLinkCount; i++)
+				linkedTrees_[i].store(npos, std::memory_order_relaxed);
+		}
+
+		/**
+		 * check that a borrowed image is well formed, every section, text and link must be in bounds
+		 * the arrays are pointed into the image once its sections are known to fit
+		 */
+		bool valid(size_t _size)
+		{
+			const Header &h = *header_;
+			auto fits = [&](uint64_t offset, uint64_t count, uint64_t size) {
+				return offset % 8 == 0 && offset <= _size && count <= (_size - offset) / size;
+			};
+			if (std::memcmp(h.magic, "TEGR", 4) != 0 || h.version != version || h.size != _size)
+				return false;
+			if (!fits(h.dialogIds, h.dialogCount, sizeof(Str)) || !fits(h.dialogMessages, h.dialogCount, sizeof(Str)) ||
+				!fits(h.dialogLinks, h.dialogCount, sizeof(uint32_t)) || !fits(h.dialogDecisions, h.dialogCount + 1ull, sizeof(uint32_t)) ||
+				!fits(h.decisionIds, h.decisionCount, sizeof(Str)) || !fits(h.decisionMessages, h.decisionCount, sizeof(Str)) ||
+				!fits(h.decisionLinks, h.decisionCount, sizeof(uint32_t)) || !fits(h.decisionValues, h.decisionCount, sizeof(int32_t)) ||
+				!fits(h.treeLinks, h.treeLinkCount, sizeof(Str)) ||
+				!fits(h.missingLinks, h.missingLinkCount, sizeof(Str)) || !fits(h.text, h.textSize, 1))
+				return false;
+			bind();
+
+			auto str = [&](Str s) { return s.offset <= h.textSize && s.length <= h.textSize - s.offset; };
+			auto link = [&](uint32_t packed) {
+				Link l = unpack(packed);
+				return l.type == LinkType::none || (l.type == LinkType::dialog && l.target < h.dialogCount) ||
+					   (l.type == LinkType::tree && l.target < h.treeLinkCount) || (l.type == LinkType::missing && l.target < h.missingLinkCount);
+			};
+			if (!str(h.id) || (h.root != npos && h.root >= h.dialogCount))
+				return false;
+			for (uint32_t i = 0; i < h.treeLinkCount; i++)
+				if (!str(treeLinks_[i]))
+					return false;
+			for (uint32_t i = 0; i < h.missingLinkCount; i++)
+				if (!str(missingLinks_[i]))
+					return false;
+			for (uint32_t i = 0; i < h.dialogCount; i++)
+				if (!str(dialogIds_[i]) || !str(dialogMessages_[i]) || !link(dialogLinks_[i]) || dialogDecisions_[i] > dialogDecisions_[i + 1])
+					return false;
+			if (dialogDecisions_[0] != 0 || dialogDecisions_[h.dialogCount] != h.decisionCount)
+				return false;
+			for (uint32_t i = 0; i < h.decisionCount; i++)
+				if (!str(decisionIds_[i]) || !str(decisionMessages_[i]) || !link(decisionLinks_[i]))
+					return false;
+			return true;
+		}
+
+		/**
+		 * get a text of the image
+		 */
+		inline std::string_view text(Str _str) const { return std::string_view(text_ + _str.offset, _str.length); }
+
+	public:
+		/**
+		 * compile a tree
+		 * decisions with no link use the link of their dialog, links to unknown dialogs end the game (and are kept as missing links)
+		 * @param _tree the parsed tree
+		 */
+		Graph(const Tree &_tree)
+		{
+			Metrics::Span span(Metrics::compile);
+			auto const &dialogs = _tree.allDialogs();
+			Builder b;
+
+			// number all dialogs first, so links can be resolved in one pass
+			FlatMap<std::string_view, uint32_t> ids;
+			ids.reserve(dialogs.size());
+			for (auto const &d : dialogs)
+				ids.emplace(d.first, (uint32_t)ids.size());
+
+			Header h{};
+			std::memcpy(h.magic, "TEGR", 4);
+			h.version = version;
+			h.id = b.add(_tree.id());
+			auto root = ids.find(_tree.root());
+			h.root = root == ids.end() ? npos : root->second;
+
+			for (auto const &d : dialogs)
+			{
+				Link dialogLink = b.resolve(_tree.id(), ids, d.second->link());
+				b.dialogIds.push_back(b.add(d.first));
+				b.dialogMessages.push_back(b.add(d.second->message()));
+				b.dialogLinks.push_back(pack(dialogLink));
+				b.dialogDecisions.push_back((uint32_t)b.decisionIds.size());
+
+				for (auto const &de : d.second->allDecisions())
+				{
+					std::string_view link = de.second->link();
+					b.decisionIds.push_back(b.add(de.first));
+					b.decisionMessages.push_back(b.add(de.second->message()));
+					b.decisionLinks.push_back(pack(link.empty() ? dialogLink : b.resolve(_tree.id(), ids, link)));
+					b.decisionValues.push_back(pack(de.second->enabled(), de.second->score()));
+				}
+			}
+			b.dialogDecisions.push_back((uint32_t)b.decisionIds.size());
+
+			h.dialogCount = (uint32_t)b.dialogIds.size();
+			h.decisionCount = (uint32_t)b.decisionIds.size();
+			h.treeLinkCount = (uint32_t)b.treeLinks.size();
+			h.missingLinkCount = (uint32_t)b.missingLinks.size();
+			h.textSize = b.text.size();
+
+			// lay out the image
+			std::vector<char> image(sizeof(Header));
+			h.dialogIds = place(image, b.dialogIds);
+			h.dialogMessages = place(image, b.dialogMessages);
+			h.dialogLinks = place(image, b.dialogLinks);
+			h.dialogDecisions = place(image, b.dialogDecisions);
+			h.decisionIds = place(image, b.decisionIds);
+			h.decisionMessages = place(image, b.decisionMessages);
+			h.decisionLinks = place(image, b.decisionLinks);
+			h.decisionValues = place(image, b.decisionValues);
+			h.treeLinks = place(image, b.treeLinks);
+			h.missingLinks = place(image, b.missingLinks);
+			h.text = place(image, std::vector<char>(b.text.begin(), b.text.end()));
+			image.resize(align(image.size()));
+			h.size = image.size();
+			std::memcpy(image.data(), &h, sizeof(Header));
+
+			storage_.resize(image.size() / 8);
+			std::memcpy(storage_.data(), image.data(), image.size());
+			header_ = reinterpret_cast<const Header *>(storage_.data());
+			bind();
+			unlink();
+			order();
+		}
+
+		/**
+		 * use a binary image directly, without copying it
+		 * @param _image image written by image(), 8 bytes aligned, must outlive the graph
+		 * @param _size size of the image
+		 * @exception invalid image
+		 */
+		Graph(const void *_image, size_t _size) : header_(static_cast<const Header *>(_image))
+		{
+			if (_size < sizeof(Header) || reinterpret_cast<uintptr_t>(_image) % 8 != 0)
+				console::log<1>("invalid compiled tree image");
+			if (!valid(_size))
+				console::log<1>("invalid compiled tree image");
+			unlink();
+			order();
+		}
+
+		Graph(const Graph &) = delete;
+		Graph &operator=(const Graph &) = delete;
+
+		/**
+		 * get the binary image of the graph, can be saved and used later with Graph(image, size)
+		 */
+		inline std::string_view image() const { return std::string_view(reinterpret_cast<const char *>(header_), header_->size); }
+
+		/**
+		 * whether the image is borrowed (used in place from a compiled story) rather than owned by the graph
+		 */
+		inline bool borrowed() const { return storage_.empty(); }
+
+		/**
+		 * get size of the text section of the image
+		 */
+		inline uint64_t textSize() const { return header_->textSize; }
+
+		/**
+		 * get id of the compiled tree
+		 */
+		inline std::string_view id() const { return text(header_->id); }
+
+		/**
+		 * get index of the first dialog, npos if the tree has no root
+		 */
+		inline uint32_t root() const { return header_->root; }
+
+		/**
+		 * find the index of a dialog by id
+		 * @return dialog index, npos if not found
+		 */
+		uint32_t find(std::string_view _id) const
+		{
+			auto it = std::lower_bound(byId_.begin(), byId_.end(), _id, [&](uint32_t a, std::string_view id) { return text(dialogIds_[a]) < id; });
+			return it != byId_.end() && text(dialogIds_[*it]) == _id ? *it : npos;
+		}
+
+		/**
+		 * get number of dialogs
+		 */
+		inline uint32_t dialogCount() const { return header_->dialogCount; }
+
+		/**
+		 * get number of decisions
+		 */
+		inline uint32_t decisionCount() const { return header_->decisionCount; }
+
+		/**
+		 * get dialog id
+		 */
+		inline std::string_view dialogId(uint32_t _dialog) const { return text(dialogIds_[_dialog]); }
+
+		/**
+		 * get dialog message
+		 */
+		inline std::string_view dialogMessage(uint32_t _dialog) const { return text(dialogMessages_[_dialog]); }
+
+		/**
+		 * get dialog link
+		 */
+		inline Link dialogLink(uint32_t _dialog) const { return unpack(dialogLinks_[_dialog]); }
+
+		/**
+		 * get index of the first decision of a dialog
+		 */
+		inline uint32_t firstDecision(uint32_t _dialog) const { return dialogDecisions_[_dialog]; }
+
+		/**
+		 * get index past the last decision of a dialog
+		 */
+		inline uint32_t lastDecision(uint32_t _dialog) const { return dialogDecisions_[_dialog + 1]; }
+
+		/**
+		 * get decision id
+		 */
+		inline std::string_view decisionId(uint32_t _decision) const { return text(decisionIds_[_decision]); }
+
+		/**
+		 * get decision message
+		 */
+		inline std::string_view decisionMessage(uint32_t _decision) const { return text(decisionMessages_[_decision]); }
+
+		/**
+		 * get decision link, inherited from the dialog if the decision has none
+		 */
+		inline Link decisionLink(uint32_t _decision) const { return unpack(decisionLinks_[_decision]); }
+
+		/**
+		 * get decision enabled status
+		 */
+		inline bool decisionEnabled(uint32_t _decision) const { return decisionValues_[_decision] & 1; }
+
+		/**
+		 * get decision score
+		 */
+		inline int decisionScore(uint32_t _decision) const { return decisionValues_[_decision] >> 1; }
+
+		/**
+		 * get number of linked trees
+		 */
+		inline uint32_t treeLinkCount() const { return header_->treeLinkCount; }
+
+		/**
+		 * get id of a linked tree
+		 * @param _index target of a tree link
+		 */
+		inline std::string_view treeLink(uint32_t _index) const { return text(treeLinks_[_index]); }
+
+		/**
+		 * get the tree index a tree link was resolved to by the engine, npos until it is resolved
+		 */
+		inline uint32_t linkedTree(uint32_t _index) const { return linkedTrees_[_index].load(std::memory_order_relaxed); }
+
+		/**
+		 * record the tree index of a tree link, tree indices never change so it stays valid
+		 * not part of the image, a graph is resolved again by every engine using it
+		 */
+		inline void linkTree(uint32_t _index, uint32_t _tree) const { linkedTrees_[_index].store(_tree, std::memory_order_relaxed); }
+
+		/**
+		 * get number of links to unknown dialogs
+		 */
+		inline uint32_t missingLinkCount() const { return header_->missingLinkCount; }
+
+		/**
+		 * get id of an unknown dialog
+		 * @param _index target of a missing link
+		 */
+		inline std::string_view missingLink(uint32_t _index) const { return text(missingLinks_[_index]); }
+	};
+
+	/**
+	 * @class search index of a graph, see Engine::searchText() and Engine::searchId()
+	 * messages are indexed by case folded trigram, ids are sorted for prefix lookups
+	 * nodes are numbered in script order, dialog d is node d + firstDecision(d) and its decisions follow it
+	 * immutable once built, an index is valid for the graph it was built from only
+	 */
+	class TextIndex
+	{
+	private:
+		const Graph &graph_;
+		FlatMap<uint32_t, uint32_t> grams_; // trigram to its postings, grams_[g] is an index into starts_
+		std::vector<uint32_t> starts_;		// postings of trigram i are postings_[starts_[i], starts_[i + 1])
+		std::vector<uint32_t> postings_;	// nodes in ascending order, once per node
+		std::vector<uint32_t> ids_;			// nodes sorted by id
+
+		/**
+		 * fold an ascii character to lower case, other bytes are kept
+		 */
+		static inline char fold(char _c) { return _c >= 'A' && _c <= 'Z' ? char(_c - 'A' + 'a') : _c; }
+
+		/**
+		 * get the trigram starting at a position of a text
+		 */
+		static inline uint32_t gram(const char *_text)
+		{
+			return uint32_t((unsigned char)fold(_text[0])) << 16 | uint32_t((unsigned char)fold(_text[1])) << 8 | (unsigned char)fold(_text[2]);
+		}
+
+		/**
+		 * check whether a text contains a case folded text, ignoring case
+		 */
+		static bool contains(std::string_view _text, std::string_view _folded)
+		{
+			if (_folded.size() > _text.size())
+				return false;
+			for (size_t i = 0; i + _folded.size() <= _text.size(); i++)
+			{
+				size_t j = 0;
+				while (j < _folded.size() && fold(_text[i + j]) == _folded[j])
+					j++;
+				if (j == _folded.size())
+					return true;
+			}
+			return false;
+		}
+
+		/**
+		 * get the message of a node
+		 */
+		inline std::string_view messageOf(uint32_t _node) const
+		{
+			Hit hit = at(_node);
+			return hit.decision == Graph::npos ? graph_.dialogMessage(hit.dialog) : graph_.decisionMessage(hit.decision);
+		}
+
+		/**
+		 * get the id of a node
+		 */
+		inline std::string_view idOf(uint32_t _node) const
+		{
+			Hit hit = at(_node);
+			return hit.decision == Graph::npos ? graph_.dialogId(hit.dialog) : graph_.decisionId(hit.decision);
+		}
+
+	public:
+		/**
+		 * @class a node found by a search
+		 */
+		struct Hit
+		{
+			uint32_t dialog;
+			uint32_t decision; // Graph::npos if the dialog itself matched
+		};
+
+		/**
+		 * index a graph, the graph must outlive the index
+		 */
+		TextIndex(const Graph &_graph) : graph_(_graph)
+		{
+			uint32_t nodes = _graph.dialogCount() + _graph.decisionCount();
+
+			// number the trigrams of every node once, nodes come in ascending order so a repeated trigram is the last one seen
+			std::vector<std::pair<uint32_t, uint32_t>> pairs; // trigram and node
+			std::vector<uint32_t> last, counts;
+			auto visit = [&](uint32_t n, std::string_view text) {
+				for (size_t i = 0; i + 3 <= text.size(); i++)
+				{
+					uint32_t g = grams_.emplace(gram(text.data() + i), (uint32_t)grams_.size()).first->second;
+					if (g == last.size())
+					{
+						last.push_back(Graph::npos);
+						counts.push_back(0);
+					}
+					if (last[g] != n)
+					{
+						last[g] = n;
+						counts[g]++;
+						pairs.push_back({g, n});
+					}
+				}
+			};
+			for (uint32_t d = 0, n = 0; d < _graph.dialogCount(); d++)
+			{
+				visit(n++, _graph.dialogMessage(d));
+				for (uint32_t de = _graph.firstDecision(d); de < _graph.lastDecision(d); de++)
+					visit(n++, _graph.decisionMessage(de));
+			}
+
+			// then place the nodes of every trigram, still in ascending order
+			starts_.assign(counts.size() + 1, 0);
+			for (size_t g = 0; g < counts.size(); g++)
+				starts_[g + 1] = starts_[g] + counts[g];
+			postings_.resize(pairs.size());
+			std::vector<uint32_t> next(starts_.begin(), starts_.end() - 1);
+			for (auto const &p : pairs)
+				postings_[next[p.first]++] = p.second;
+
+			std::vector<std::pair<std::string_view, uint32_t>> ids;
+			ids.reserve(nodes);
+			for (uint32_t d = 0; d < _graph.dialogCount(); d++)
+			{
+				ids.push_back({_graph.dialogId(d), (uint32_t)ids.size()});
+				for (uint32_t de = _graph.firstDecision(d); de < _graph.lastDecision(d); de++)
+					ids.push_back({_graph.decisionId(de), (uint32_t)ids.size()});
+			}
+			std::sort(ids.begin(), ids.end());
+			ids_.reserve(nodes);
+			for (auto const &id : ids)
+				ids_.push_back(id.second);
+		}
+
+		TextIndex(const TextIndex &) = delete;
+		TextIndex &operator=(const TextIndex &) = delete;
+
+		/**
+		 * get the dialog and decision of a node
+		 */
+		Hit at(uint32_t _node) const
+		{
+			// the first dialog whose node is past _node, dialog nodes grow with every dialog
+			uint32_t low = 0, high = graph_.dialogCount();
+			while (low < high)
+			{
+				uint32_t mid = low + (high - low) / 2;
+				if (mid + graph_.firstDecision(mid) <= _node)
+					low = mid + 1;
+				else
+					high = mid;
+			}
+			uint32_t dialog = low - 1, first = dialog + graph_.firstDecision(dialog);
+			return {dialog, _node == first ? Graph::npos : graph_.firstDecision(dialog) + (_node - first - 1)};
+		}
+
+		/**
+		 * find the nodes whose message contains a text, ignoring ascii case
+		 * texts shorter than a trigram are searched in every message
+		 * @param _limit largest number of nodes returned
+		 * @return nodes in script order
+		 */
+		std::vector<uint32_t> match(std::string_view _text, size_t _limit = SIZE_MAX) const
+		{
+			std::string folded(_text);
+			for (auto &c : folded)
+				c = fold(c);
+
+			std::vector<uint32_t> found;
+			uint32_t nodes = graph_.dialogCount() + graph_.decisionCount();
+			if (folded.size() < 3)
+			{
+				for (uint32_t n = 0; n < nodes && found.size() < _limit; n++)
+					if (contains(messageOf(n), folded))
+						found.push_back(n);
+				return found;
+			}
+
+			// every trigram of the text must be in the message, candidates come from the rarest trigram
+			std::vector<std::pair<const uint32_t *, const uint32_t *>> lists;
+			for (size_t i = 0; i + 3 <= folded.size(); i++)
+			{
+				auto it = grams_.find(gram(folded.data() + i));
+				if (it == grams_.end())
+					return found;
+				lists.push_back({postings_.data() + starts_[it->second], postings_.data() + starts_[it->second + 1]});
+			}
+			std::sort(lists.begin(), lists.end(), [](auto const &a, auto const &b) { return a.second - a.first < b.second - b.first; });
+
+			for (const uint32_t *n = lists[0].first; n != lists[0].second && found.size() < _limit; n++)
+			{
+				bool all = true;
+				for (size_t l = 1; l < lists.size() && all; l++)
+					all = std::binary_search(lists[l].first, lists[l].second, *n);
+				if (all && contains(messageOf(*n), folded))
+					found.push_back(*n);
+			}
+			return found;
+		}
+
+		/**
+		 * find the nodes whose id starts with a prefix, case sensitive
+		 * @param _limit largest number of nodes returned
+		 * @return nodes in script order
+		 */
+		std::vector<uint32_t> prefix(std::string_view _prefix, size_t _limit = SIZE_MAX) const
+		{
+			auto it = std::lower_bound(ids_.begin(), ids_.end(), _prefix, [&](uint32_t n, std::string_view prefix) { return idOf(n) < prefix; });
+			std::vector<uint32_t> found;
+			for (; it != ids_.end() && idOf(*it).substr(0, _prefix.size()) == _prefix; it++)
+				found.push_back(*it);
+			std::sort(found.begin(), found.end());
+			if (found.size() > _limit)
+				found.resize(_limit);
+			return found;
+		}
+
+		/**
+		 * get bytes of the index
+		 */
+		inline size_t bytes() const
+		{
+			return grams_.size() * sizeof(FlatMap<uint32_t, uint32_t>::value_type) + (starts_.size() + postings_.size() + ids_.size()) * sizeof(uint32_t);
+		}
+	};
+
+	/**
+	 * @class read-only memory mapping of a script file
+	 */
+	class MappedFile
+	{
+	public:
+		/**
+		 * @class modification time and size of a file, to detect changes
+		 */
+		struct Stamp
+		{
+			int64_t modified = -1; // nanoseconds since epoch, -1 if unknown
+			int64_t size = -1;
+
+			inline bool operator==(const Stamp &_other) const { return modified == _other.modified && size == _other.size; }
+			inline bool operator!=(const Stamp &_other) const { return !(*this == _other); }
+		};
+
+	private:
+		const char *data_ = nullptr;
+		size_t size_ = 0;
+		bool open_ = false;
+		Stamp stamp_;
+
+		/**
+		 * get the stamp of a file status
+		 */
+		static Stamp stamp(const struct stat &_st) { return {int64_t(_st.st_mtim.tv_sec) * 1000000000 + _st.st_mtim.tv_nsec, int64_t(_st.st_size)}; }
+
+	public:
+		/**
+		 * get the current stamp of a file, without opening it
+		 * @return the stamp, unknown if the file cannot be found
+		 */
+		static Stamp stamp(const std::string &_path)
+		{
+			struct stat st;
+			return ::stat(_path.c_str(), &st) == 0 ? stamp(st) : Stamp{};
+		}
+
+		/**
+		 * map a file into memory, check isOpen() for success
+		 * @param _advice expected use of the pages (madvise), default = MADV_SEQUENTIAL (read once, like a script)
+		 */
+		MappedFile(const std::string &_path, int _advice = MADV_SEQUENTIAL)
+		{
+			int fd = ::open(_path.c_str(), O_RDONLY);
+			if (fd < 0)
+				return;
+
+			struct stat st;
+			if (::fstat(fd, &st) == 0)
+			{
+				size_ = (size_t)st.st_size;
+				stamp_ = stamp(st);
+				open_ = true;
+
+				// empty files cannot be mapped, they are simply an empty view
+				if (size_ > 0)
+				{
+					void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+					if (data == MAP_FAILED)
+						open_ = false, size_ = 0;
+					else
+					{
+						::madvise(data, size_, _advice);
+						data_ = static_cast<const char *>(data);
+					}
+				}
+			}
+			::close(fd);
+		}
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		/**
+		 * whether the file was opened and mapped
+		 */
+		inline bool isOpen() const { return open_; }
+
+		/**
+		 * get the content of the file
+		 */
+		inline std::string_view view() const { return std::string_view(data_, size_); }
+
+		/**
+		 * get the stamp of the file when it was mapped
+		 */
+		inline const Stamp &stamp() const { return stamp_; }
+
+		~MappedFile()
+		{
+			if (data_ != nullptr)
+				::munmap(const_cast<char *>(data_), size_);
+		}
+	};
+
+	/**
+	 * @class parse a data file and create a game tree
+	 * the script is scanned once, token boundaries are found while parsing the token text
+	 */
+	class Parser
+	{
+	private:
+		static const int uniqueSeed; // first generated id of every tree, generated ids are only unique within a tree
+
+		/**
+		 * @class parsing token
+		 * buffers are reused between tokens, the id is a slice of the script (or of generated)
+		 * the text is a slice of the script too unless line breaks or escapes split it, so most texts are copied once, into the tree
+		 */
+		struct Token
+		{
+			std::string_view text = ""; // slice of the script, or of buffer
+			std::string buffer = "";	// text made of several runs of the script
+			bool buffered = false;		// whether text is in buffer
+
+			std::string_view id = "";
+			std::string generated = ""; // generated id of a token without id
+			std::string link = "";		// link with the link type appended
+			bool isTreeLink = false;
+
+			bool hasId = false;
+			bool hasLink = false;
+
+			/**
+			 * reset for the next token, keep buffer capacity
+			 */
+			void clear()
+			{
+				text = "";
+				buffer.clear();
+				buffered = false;
+				id = "";
+				link.clear();
+				isTreeLink = hasId = hasLink = false;
+			}
+
+			/**
+			 * append a run of the script to the text, a run right after the text extends the slice
+			 */
+			inline void append(const char *_run, size_t _size)
+			{
+				if (_size == 0)
+					return;
+				if (text.empty())
+					text = std::string_view(_run, _size);
+				else if (!buffered && text.data() + text.size() == _run)
+					text = std::string_view(text.data(), text.size() + _size);
+				else
+				{
+					if (!buffered)
+						buffer.assign(text), buffered = true;
+					buffer.append(_run, _size);
+					text = buffer;
+				}
+			}
+		};
+
+		/**
+		 * find the next `Stop` character or line break, 32 (AVX2) or 16 (SSE2, NEON) bytes at a time
+		 * @return pointer to the character, or end
+		 */
+		template <char Stop>
+		static inline const char *scan(const char *it, const char *end)
+		{
+#if TEXTENGINE_SIMD && defined(__AVX2__)
+			const __m256i stop = _mm256_set1_epi8(Stop), lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+			for (; end - it >= 32; it += 32)
+			{
+				__m256i v = _mm256_loadu_si256((const __m256i *)it);
+				__m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, stop), _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+				if (uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit))
+					return it + __builtin_ctz(mask);
+			}
+#endif
+#if TEXTENGINE_SIMD && defined(__SSE2__)
+			const __m128i stop16 = _mm_set1_epi8(Stop), lf16 = _mm_set1_epi8('\n'), cr16 = _mm_set1_epi8('\r');
+			for (; end - it >= 16; it += 16)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i *)it);
+				__m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, stop16), _mm_or_si128(_mm_cmpeq_epi8(v, lf16), _mm_cmpeq_epi8(v, cr16)));
+				if (uint32_t mask = (uint32_t)_mm_movemask_epi8(hit))
+					return it + __builtin_ctz(mask);
+			}
+#elif TEXTENGINE_SIMD && defined(__ARM_NEON) && defined(__aarch64__)
+			const uint8x16_t stop = vdupq_n_u8((uint8_t)Stop), lf = vdupq_n_u8('\n'), cr = vdupq_n_u8('\r');
+			for (; end - it >= 16; it += 16)
+			{
+				uint8x16_t v = vld1q_u8((const uint8_t *)it);
+				uint8x16_t hit = vorrq_u8(vceqq_u8(v, stop), vorrq_u8(vceqq_u8(v, lf), vceqq_u8(v, cr)));
+				// narrow to 4 bits per byte, there is no movemask
+				uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+				if (mask)
+					return it + (__builtin_ctzll(mask) >> 2);
+			}
+#endif
+			while (it != end && *it != Stop && *it != '\n' && *it != '\r')
+				it++;
+			return it;
+		}
+
+		/**
+		 * find the next character that needs attention (`$` or line break)
+		 * @return pointer to the character, or end
+		 */
+		static inline const char *skipText(const char *it, const char *end) { return scan<'$'>(it, end); }
+
+		/**
+		 * parse a marker (id, links...)
+		 * @param it pointer to the opening bracket `[`, return the pointer after the marker (and the trimmed whitespaces)
+		 * @param end end of the script
+		 * @return the parsed marker value, a marker cannot span multiple lines
+		 */
+		static std::string_view parseMarkerValue(const configure &config, const char *&it, const char *end)
+		{
+			// parse the marker
+			const char *begin = ++it;
+			it = scan<']'>(it, end);
+			std::string_view marker(begin, it - begin);
+			if (it != end && *it == ']')
+				it++;
+
+			// trim whitespaces after a marker (if option is enabled)
+			if (config.trim_whitespaces_behind_markers)
+				while (it != end && *it == ' ')
+					it++;
+
+			return marker;
+		}
+
+		/**
+		 * parse a token
+		 * can parse id and link (either type) anywhere in the token, line breaks are removed from the text
+		 * @param config program configuration
+		 * @param curr current token being parsed
+		 * @param line_num current line number, updated while parsing
+		 * @param it pointer after the starter character, return the pointer to the starter of the next token (or end)
+		 * @param end end of the script
+		 * @param diagnostics receive duplicate markers, the first marker of each kind is kept
+		 */
+		static void parseToken(const configure &config, Token &curr, int &line_num, const char *&it, const char *end, Diagnostics &diagnostics)
+		{
+			while (it != end)
+			{
+				// normal text is appended in bulk
+				const char *text = it;
+				it = skipText(it, end);
+				curr.append(text, it - text);
+				if (it == end)
+					break;
+
+				// a line starting with a starter character ends the token
+				if (*it == '\n')
+				{
+					line_num++;
+					if (++it != end && (*it == '-' || *it == '+'))
+						return;
+				}
+
+				else if (*it == '\r')
+					it++;
+
+				// if marker character `$` is found
+				else if (++it == end)
+					curr.append(it - 1, 1);
+
+				// `$[` creates id marker
+				else if (*it == '[')
+				{
+					std::string_view id = parseMarkerValue(config, it, end);
+					if ((curr.hasId = !curr.hasId)) // basically check if hasId is false by flipping it and see if it's true
+						curr.id = id;
+					else
+						diagnostics.report<1>(line_num, "found another id within token: ", id), curr.hasId = true;
+				}
+
+				// `$T[` or `$t[` creates tree marker and `$D[` or `$d[` creates dialog marker
+				else if ((*it == 'T' || *it == 't' || *it == 'D' || *it == 'd') && it + 1 != end && it[1] == '[')
+				{
+					char linkType = *it++;
+					std::string_view link = parseMarkerValue(config, it, end);
+
+					if ((curr.hasLink = !curr.hasLink)) // like hasId above
+					{
+						curr.link.assign(link);
+						curr.link.push_back(linkType);
+						curr.isTreeLink = linkType == 'T' || linkType == 't';
+					}
+					else
+						diagnostics.report<1>(line_num, "found another link within token: ", link, linkType), curr.hasLink = true;
+				}
+
+				// if 2 `$` are found, escape the phrase
+				else if (*it == '$')
+				{
+					curr.append(it, 1);
+					it++;
+				}
+
+				// if no marker is completed, restore the text
+				else
+					curr.append(it - 1, 1);
+			}
+		}
+
+		/**
+		 * give a generated id to a token without id
+		 * @param uniqueInt generated id counter of the tree being parsed
+		 */
+		static void processId(Token &curr, int &uniqueInt)
+		{
+			if (curr.hasId)
+				return;
+			curr.generated = std::to_string(++uniqueInt);
+			curr.id = curr.generated;
+		}
+
+		/**
+		 * post processing the dialog
+		 * a dialog without link jumps to the next dialog of the script, or ends the game if it is the last one
+		 * @param dialog the new dialog, nullptr if it is a duplicate (its decisions are then dropped)
+		 * @param pending the last dialog without link, linked to the new dialog
+		 */
+		static Tree *processDialog(const std::string &fname, Token &curr, int line_num, Tree *tree, Dialog *&dialog, Dialog *&pending, Diagnostics &diagnostics)
+		{
+			// create the tree if it's not yet created (creating the tree requiring the link to the first dialog)
+			if (tree == nullptr)
+				tree = new Tree(fname, std::string(curr.id), 0);
+
+			if (tree->find(curr.id) != nullptr)
+			{
+				diagnostics.report<1>(line_num, "duplicate dialog id: ", curr.id);
+				dialog = nullptr;
+				return tree;
+			}
+
+			dialog = tree->insertDialog(curr.id, curr.text, curr.link);
+			if (pending != nullptr)
+			{
+				curr.generated.assign(curr.id);
+				curr.generated.push_back('d');
+				pending->link(curr.generated);
+			}
+			pending = curr.hasLink ? nullptr : dialog;
+			return tree;
+		}
+
+		/**
+		 * @class state of a script being parsed, kept between the chunks of a stream
+		 */
+		struct State
+		{
+			Tree *tree = nullptr;		// current tree, will be created once the first dialog is successfully parsed
+			Dialog *dialog = nullptr;	// current dialog
+			bool duplicate = false;		// the current dialog is a duplicate, its decisions are dropped with it
+			Dialog *pending = nullptr;	// last dialog without link, waiting for the next dialog
+			Token curr;					// current token
+			int line_num = 1;			// line num, for debugging
+			int uniqueInt = uniqueSeed; // generated ids are numbered per tree, so parsing is deterministic
+		};
+
+		/**
+		 * parse whole tokens, the text must end at the end of the script or right before a starter after a line break
+		 * @param state the state after the previous text of the script, updated
+		 */
+		static void parse(const configure &config, const std::string &fname, State &state, const char *it, const char *end, Diagnostics &diagnostics)
+		{
+			Metrics::Span span(Metrics::parse);
+			uint64_t tokens = 0, markers = 0; // counted locally, published once per call
+			Token &curr = state.curr;
+			int &line_num = state.line_num;
+			while (it != end)
+			{
+				// text outside of any token (before the first one) is dismissed
+				if (*it != '-' && *it != '+')
+				{
+					if (*it != '\n' && *it != '\r')
+						diagnostics.report<2>(line_num, "found text outside of any dialog or decision");
+					while (it != end && !(*it == '\n' && it + 1 != end && (it[1] == '-' || it[1] == '+')))
+						line_num += *it++ == '\n';
+					if (it != end)
+						line_num++, it++;
+					continue;
+				}
+
+				char starter = *it++;
+				while (it != end && *it == ' ') // trim whitespace
+					it++;
+
+				int token_line = line_num;
+				curr.clear();
+				parseToken(config, curr, line_num, it, end, diagnostics);
+				if constexpr (Metrics::enabled)
+					tokens++, markers += curr.hasId + curr.hasLink;
+				processId(curr, state.uniqueInt);
+
+				// if current token is a dialog
+				if (starter == '-')
+				{
+					state.tree = processDialog(fname, curr, token_line, state.tree, state.dialog, state.pending, diagnostics);
+					state.duplicate = state.dialog == nullptr;
+				}
+
+				// if current token is a decision, and there is a dialog to attach to
+				// therefore, all decisions parsed before the first dialog is parsed in the file will be discarded
+				else if (state.dialog == nullptr)
+				{
+					if (!state.duplicate)
+						diagnostics.report<2>(token_line, "found a decision cannot be attached to any dialog");
+				}
+				else if (state.dialog->find(curr.id) != nullptr)
+					diagnostics.report<1>(token_line, "duplicate decision id: ", curr.id);
+				else
+					state.dialog->insertDecision(curr.id, curr.text, curr.link, true, 0);
+			}
+			Metrics::add(Metrics::tokens, tokens);
+			Metrics::add(Metrics::markers, markers);
+		}
+
+	public:
+		/**
+		 * @class push parser, a script is fed in chunks of any size (from a socket or a pipe) and finish() returns the tree
+		 * whole tokens are parsed as soon as the start of the next one arrives, only the last incomplete token is buffered
+		 * holds no shared state, different streams can be parsed concurrently
+		 */
+		class Stream
+		{
+		private:
+			const configure &config_;
+			const std::string id_;	   // id of the tree
+			Diagnostics &diagnostics_; // receive errors and warnings
+			State state_;
+			std::string buffer_;	   // text of the incomplete token
+			size_t scanned_ = 0;	   // bytes of buffer_ already searched for a token start
+			bool finished_ = false;
+
+		public:
+			/**
+			 * start a script
+			 * @param _id id of the tree, like the file name of a script file
+			 * @param _diagnostics receive errors and warnings, never throws on script errors
+			 */
+			Stream(const configure &_config, const std::string &_id, Diagnostics &_diagnostics) : config_(_config), id_(_id), diagnostics_(_diagnostics) {}
+
+			Stream(const Stream &) = delete;
+			Stream &operator=(const Stream &) = delete;
+
+			/**
+			 * get the id of the tree
+			 */
+			inline const std::string &id() const { return id_; }
+
+			/**
+			 * get the diagnostics of the script
+			 */
+			inline Diagnostics &diagnostics() const { return diagnostics_; }
+
+			/**
+			 * parse the next chunk of the script
+			 * tokens split between chunks are parsed once complete, a chunk only needs to outlive this call
+			 */
+			void feed(std::string_view _chunk)
+			{
+				if (finished_)
+					console::log<1>("stream is finished: ", id_);
+				buffer_.append(_chunk);
+
+				// whole tokens end right before the last starter that begins a line
+				size_t start = buffer_.npos;
+				for (size_t i = buffer_.size(); i-- > std::max<size_t>(scanned_, 1);)
+					if (buffer_[i - 1] == '\n' && (buffer_[i] == '-' || buffer_[i] == '+'))
+					{
+						start = i;
+						break;
+					}
+				scanned_ = buffer_.size();
+				if (start == buffer_.npos)
+					return;
+
+				parse(config_, id_, state_, buffer_.data(), buffer_.data() + start, diagnostics_);
+				buffer_.erase(0, start);
+				scanned_ = buffer_.size();
+			}
+
+			/**
+			 * parse the rest of the script, the caller takes ownership of the tree
+			 * @return the tree, nullptr if the script has no dialog, the tree is incomplete if errors were reported
+			 */
+			Tree *finish()
+			{
+				if (finished_)
+					return nullptr;
+				finished_ = true;
+				parse(config_, id_, state_, buffer_.data(), buffer_.data() + buffer_.size(), diagnostics_);
+				std::string().swap(buffer_);
+				Tree *tree = state_.tree;
+				state_.tree = nullptr;
+				return tree;
+			}
+
+			/**
+			 * destructor, delete the tree of an unfinished stream
+			 */
+			~Stream() { delete state_.tree; }
+		};
+
+		/**
+		 * parse a script held in memory (a mapped file or a caller supplied buffer), never throws on script errors
+		 * the whole script is parsed, every error is reported and the offending marker, dialog or decision is skipped
+		 * the buffer only needs to outlive this call
+		 * holds no shared state, different scripts can be parsed concurrently
+		 * @param diagnostics receive errors and warnings
+		 * @return the tree, nullptr if the script has no dialog, the tree is incomplete if errors were reported
+		 */
+		static Tree *create(const configure &config, const std::string &fname, std::string_view script, Diagnostics &diagnostics)
+		{
+			State state;
+			parse(config, fname, state, script.data(), script.data() + script.size(), diagnostics);
+			return state.tree;
+		}
+
+		/**
+		 * parse a script held in memory, warnings are logged
+		 * @return the tree, nullptr if the script has no dialog
+		 * @exception the first error of the script, reported once the whole script is parsed
+		 */
+		static Tree *create(const configure &config, const std::string &fname, std::string_view script)
+		{
+			Diagnostics diagnostics(false);
+			Tree *tree = create(config, fname, script, diagnostics);
+			if (!diagnostics.ok())
+			{
+				delete tree;
+				diagnostics.raise();
+			}
+			return tree;
+		}
+
+		/**
+		 * parse a script from a stream, the stream is read in chunks and does not need to be seekable
+		 * @exception the first error of the script
+		 */
+		static Tree *create(const configure &config, const std::string &fname, std::istream &file)
+		{
+			Diagnostics diagnostics(false);
+			Stream stream(config, fname, diagnostics);
+			char chunk[64 * 1024];
+			while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0)
+				stream.feed(std::string_view(chunk, file.gcount()));
+			Tree *tree = stream.finish();
+			if (!diagnostics.ok())
+			{
+				delete tree;
+				diagnostics.raise();
+			}
+			return tree;
+		}
+	};
+
+	/**
+	 * @class run independent jobs on multiple threads
+	 */
+	class Workers
+	{
+	public:
+		/**
+		 * get the default number of threads
+		 */
+		static unsigned concurrency()
+		{
+			unsigned threads = std::thread::hardware_concurrency();
+			return threads == 0 ? 1 : threads;
+		}
+
+		/**
+		 * call job(i) for every i in [0, count), jobs are handed out one by one to the next free thread
+		 * the first exception thrown by a job is rethrown once all threads are joined, remaining jobs are skipped
+		 * @param count number of jobs
+		 * @param job the job, must be safe to call concurrently with different indices
+		 * @param _threads number of threads, default = 0 (hardware concurrency)
+		 */
+		template <typename Job>
+		static void run(size_t count, Job &&job, unsigned _threads = 0)
+		{
+			if (_threads == 0)
+				_threads = concurrency();
+			if (_threads > count)
+				_threads = (unsigned)count;
+
+			std::atomic<size_t> next{0};
+			std::atomic<bool> failed{false};
+			std::exception_ptr error;
+
+			auto worker = [&]() {
+				for (size_t i; !failed.load(std::memory_order_relaxed) && (i = next.fetch_add(1)) < count;)
+				{
+					try
+					{
+						job(i);
+					}
+					catch (...)
+					{
+						if (!failed.exchange(true))
+							error = std::current_exception();
+					}
+				}
+			};
+
+			// the calling thread is one of the workers
+			std::vector<std::thread> threads;
+			for (unsigned t = 1; t < _threads; t++)
+				threads.emplace_back(worker);
+			worker();
+			for (auto &t : threads)
+				t.join();
+
+			if (error)
+				std::rethrow_exception(error);
+		}
+	};
+
+	/**
+	 * @class state of a single player: position, scores and decision overrides
+	 * the story itself is never modified by sessions, so one engine serves any number of sessions
+	 * memory is proportional to the number of trees and to the trees where decisions were toggled
+	 * a session keeps the graph it is in alive, a tree reloaded meanwhile is picked up at the next step
+	 */
+	class Session
+	{
+		friend class Engine;
+
+	private:
+		/**
+		 * @class decisions of a tree whose enabled status differs from the story
+		 */
+		struct Toggles
+		{
+			std::shared_ptr<const Graph> graph; // graph the decision indices refer to, a reloaded tree has a new graph
+			std::vector<uint64_t> bits;			// bitset of decisions, allocated on first toggle
+			uint32_t count = 0;					// number of bits set
+		};
+
+		uint64_t id_ = 0;					// number of the session in the engine, see Recorder
+		uint32_t tree_ = Graph::npos;		// index of the current tree
+		uint32_t dialog_ = Graph::npos;		// index of the current dialog in the tree graph
+		std::shared_ptr<const Graph> graph_; // graph of the current tree, kept alive while the session is in it
+		std::vector<int> scores_;			// score of every tree
+		std::vector<Toggles> toggled_;		// per tree decision overrides
+#if TEXTENGINE_METRICS
+		Metrics::Histogram latency_; // latency of the steps of the session
+#endif
+
+		/**
+		 * flip the enabled status of a decision
+		 * @param _graph graph of the tree, the decision index refers to it
+		 */
+		void toggle(uint32_t _tree, uint32_t _decision, const std::shared_ptr<const Graph> &_graph)
+		{
+			if (toggled_.size() <= _tree)
+				toggled_.resize(_tree + 1);
+			Toggles &toggles = toggled_[_tree];
+			if (toggles.bits.empty())
+			{
+				toggles.graph = _graph;
+				toggles.bits.resize((_graph->decisionCount() + 63) / 64);
+			}
+			uint64_t &word = toggles.bits[_decision / 64];
+			word ^= uint64_t(1) << (_decision % 64);
+			toggles.count += (word >> (_decision % 64) & 1) ? 1 : -1;
+		}
+
+		/**
+		 * increment the score of a tree
+		 */
+		void incrementScore(uint32_t _tree, int _value)
+		{
+			if (scores_.size() <= _tree)
+				scores_.resize(_tree + 1, 0);
+			scores_[_tree] += _value;
+		}
+
+	public:
+		/**
+		 * whether the game has ended
+		 */
+		inline bool done() const { return dialog_ == Graph::npos; }
+
+		/**
+		 * get id of the session, numbered by the engine when started or restored, copies keep the id
+		 */
+		inline uint64_t id() const { return id_; }
+
+		/**
+		 * set id of the session, a player id for instance, steps are recorded under it
+		 */
+		inline void id(uint64_t _id) { id_ = _id; }
+
+		/**
+		 * get index of the current tree
+		 */
+		inline uint32_t tree() const { return tree_; }
+
+		/**
+		 * get index of the current dialog, in the graph of the current tree
+		 */
+		inline uint32_t dialog() const { return dialog_; }
+
+		/**
+		 * get score of a tree
+		 */
+		inline int score(uint32_t _tree) const { return _tree < scores_.size() ? scores_[_tree] : 0; }
+
+		/**
+		 * set score of a tree
+		 */
+		void score(uint32_t _tree, int _value)
+		{
+			if (scores_.size() <= _tree)
+				scores_.resize(_tree + 1, 0);
+			scores_[_tree] = _value;
+		}
+
+		/**
+		 * get the sum of the scores of all trees
+		 */
+		int totalScore() const
+		{
+			int total = 0;
+			for (auto s : scores_)
+				total += s;
+			return total;
+		}
+
+		/**
+		 * whether the enabled status of a decision is overridden
+		 */
+		inline bool toggled(uint32_t _tree, uint32_t _decision) const
+		{
+			return _tree < toggled_.size() && !toggled_[_tree].bits.empty() && (toggled_[_tree].bits[_decision / 64] >> (_decision % 64) & 1);
+		}
+
+#if TEXTENGINE_METRICS
+		/**
+		 * get the latency of the steps (next and choose) of the session
+		 */
+		inline const Metrics::Histogram &latency() const { return latency_; }
+#endif
+	};
+
+	/**
+	 * @class state of a walk played by Engine::run, handed to the policy at every choice
+	 */
+	struct Walk
+	{
+		static constexpr uint32_t stop = UINT32_MAX; // returned by a policy to end the walk
+
+		size_t index;	  // number of the walk in the run
+		uint32_t step;	  // number of steps made so far
+		uint32_t choices; // number of decisions chosen so far
+		uint64_t random;  // random state of the walk, seeded from the run seed and the walk number
+
+		/**
+		 * get the next random number of the walk (xorshift64*)
+		 */
+		inline uint64_t next()
+		{
+			random ^= random >> 12;
+			random ^= random << 25;
+			random ^= random >> 27;
+			return random * 0x2545F4914F6CDD1Dull;
+		}
+
+		/**
+		 * get a random number in [0, _count)
+		 */
+		inline uint32_t below(uint32_t _count) { return (uint32_t)((next() >> 32) * _count >> 32); }
+
+		/**
+		 * mix a seed and a walk number into a random state (splitmix64), never 0
+		 */
+		static uint64_t seed(uint64_t _seed, size_t _index)
+		{
+			uint64_t z = _seed + (_index + 1) * 0x9E3779B97F4A7C15ull;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			z ^= z >> 31;
+			return z == 0 ? 1 : z;
+		}
+	};
+
+	/**
+	 * @class policy choosing uniformly among the enabled decisions
+	 */
+	struct RandomPolicy
+	{
+		/**
+		 * @param _choices number of enabled decisions of the current dialog
+		 * @return index among the enabled decisions
+		 */
+		inline uint32_t operator()(Walk &_walk, const Session &, const Graph &, uint32_t _choices) const { return _walk.below(_choices); }
+	};
+
+	/**
+	 * @class policy replaying fixed choices, walk i plays script i (modulo the number of scripts)
+	 * a script is a list of indices among the enabled decisions, the walk stops at the end of its script or at an invalid index
+	 */
+	class ScriptedPolicy
+	{
+	private:
+		std::vector<std::vector<uint32_t>> scripts_;
+
+	public:
+		ScriptedPolicy(std::vector<std::vector<uint32_t>> _scripts) : scripts_(std::move(_scripts)) {}
+
+		/**
+		 * @return the next choice of the script of the walk, Walk::stop at its end
+		 */
+		uint32_t operator()(Walk &_walk, const Session &, const Graph &, uint32_t _choices) const
+		{
+			if (scripts_.empty())
+				return Walk::stop;
+			auto const &script = scripts_[_walk.index % scripts_.size()];
+			return _walk.choices < script.size() && script[_walk.choices] < _choices ? script[_walk.choices] : Walk::stop;
+		}
+	};
+
+	/**
+	 * @class totals of a batch of walks, see Engine::run and Engine::explore
+	 */
+	struct RunStats
+	{
+		uint64_t walks = 0;	   // walks played
+		uint64_t steps = 0;	   // decisions chosen and links followed
+		uint64_t finished = 0; // walks that reached an end of the game, the others were stopped or ran out of steps
+		int64_t scoreSum = 0;  // sum of the total scores of all walks
+		int minScore = 0;	   // lowest total score of a walk
+		int maxScore = 0;	   // highest total score of a walk
+		double seconds = 0;	   // wall clock time of the run
+
+		/**
+		 * get the number of steps per second
+		 */
+		inline double stepsPerSecond() const { return seconds > 0 ? steps / seconds : 0; }
+
+		/**
+		 * add a finished walk
+		 */
+		void add(const Session &_session, uint32_t _steps)
+		{
+			int score = _session.totalScore();
+			minScore = walks == 0 ? score : std::min(minScore, score);
+			maxScore = walks == 0 ? score : std::max(maxScore, score);
+			walks++;
+			steps += _steps;
+			finished += _session.done();
+			scoreSum += score;
+		}
+
+		/**
+		 * add the totals of another part of the run
+		 */
+		void add(const RunStats &_other)
+		{
+			if (_other.walks == 0)
+				return;
+			minScore = walks == 0 ? _other.minScore : std::min(minScore, _other.minScore);
+			maxScore = walks == 0 ? _other.maxScore : std::max(maxScore, _other.maxScore);
+			walks += _other.walks;
+			steps += _other.steps;
+			finished += _other.finished;
+			scoreSum += _other.scoreSum;
+		}
+	};
+
+	/**
+	 * @class one step of a session, see Recorder
+	 */
+	struct Record
+	{
+		static constexpr uint32_t next = UINT32_MAX; // decision of a step that followed the dialog link, like Engine::next()
+
+		uint64_t session;  // id of the session
+		uint32_t tree;	   // tree index of the session before the step
+		uint32_t dialog;   // dialog index in the graph of the tree, before the step
+		uint32_t decision; // index of the decision within the dialog, or next
+		uint64_t time;	   // steady clock time of the step in nanoseconds
+	};
+
+	/**
+	 * @class append-only log of the steps of all sessions of an engine, see Engine::record
+	 * every thread appends to its own list of chunks without locking, drain() reads the chunks while they are written
+	 * a thread takes a lock only the first time it records, a single thread drains at a time
+	 */
+	class Recorder
+	{
+	private:
+		/**
+		 * @class fixed block of records, written by one thread and read by drain()
+		 */
+		struct Chunk
+		{
+			static constexpr uint32_t capacity = 4096;
+
+			Record records[capacity];
+			std::atomic<uint32_t> count{0};		// records written, published after each record
+			std::atomic<Chunk *> next{nullptr}; // chunk written after this one, set once it is full, or next spare chunk
+		};
+
+		/**
+		 * delete a list of chunks
+		 */
+		static void release(Chunk *_chunk)
+		{
+			while (_chunk != nullptr)
+			{
+				Chunk *next = _chunk->next.load(std::memory_order_relaxed);
+				delete _chunk;
+				_chunk = next;
+			}
+		}
+
+		/**
+		 * @class records of one thread
+		 */
+		struct Lane
+		{
+			std::thread::id thread;
+			Chunk *head;	   // oldest chunk not drained, owned by drain()
+			uint32_t read = 0; // records of head already drained
+			Chunk *tail;	   // chunk being written, owned by the thread
+			Chunk *unused = nullptr;			   // spare chunks taken by the thread, written next
+			std::atomic<Chunk *> spare{nullptr}; // chunks drained, handed back to the thread so their pages stay mapped
+		};
+
+		std::mutex mutex_;						   // guards lanes_, taken when a thread records for the first time and by drain()
+		std::vector<std::unique_ptr<Lane>> lanes_; // one per thread that recorded, never moved
+		const uint64_t id_;						   // tells recorders apart in the threads lane cache, even at the same address
+		static std::atomic<uint64_t> ids_;
+
+		/**
+		 * get the lane of the calling thread, created the first time the thread records
+		 */
+		Lane *lane()
+		{
+			struct Cache
+			{
+				uint64_t recorder = 0;
+				Lane *lane = nullptr;
+			};
+			thread_local Cache cache; // lane of the last recorder used by the thread
+			if (cache.recorder == id_)
+				return cache.lane;
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			std::thread::id self = std::this_thread::get_id();
+			auto it = std::find_if(lanes_.begin(), lanes_.end(), [&](const std::unique_ptr<Lane> &l) { return l->thread == self; });
+			if (it == lanes_.end())
+			{
+				Chunk *chunk = new Chunk;
+				lanes_.emplace_back(new Lane{self, chunk, 0, chunk});
+				it = lanes_.end() - 1;
+			}
+			cache = {id_, it->get()};
+			return cache.lane;
+		}
+
+	public:
+		Recorder() : id_(ids_.fetch_add(1) + 1) {}
+		Recorder(const Recorder &) = delete;
+		Recorder &operator=(const Recorder &) = delete;
+
+		/**
+		 * get the time of a step, steady clock in nanoseconds
+		 */
+		static inline uint64_t now() { return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+		/**
+		 * append a step, lock free once the thread has recorded
+		 */
+		void add(const Record &_record)
+		{
+			Lane *lane = this->lane();
+			uint32_t count = lane->tail->count.load(std::memory_order_relaxed);
+			if (count == Chunk::capacity)
+			{
+				if (lane->unused == nullptr)
+					lane->unused = lane->spare.exchange(nullptr, std::memory_order_acquire);
+				Chunk *chunk = lane->unused;
+				if (chunk != nullptr)
+				{
+					lane->unused = chunk->next.load(std::memory_order_relaxed);
+					chunk->count.store(0, std::memory_order_relaxed);
+					chunk->next.store(nullptr, std::memory_order_relaxed);
+				}
+				else
+					chunk = new Chunk;
+				lane->tail->next.store(chunk, std::memory_order_release);
+				lane->tail = chunk;
+				count = 0;
+			}
+			lane->tail->records[count] = _record;
+			lane->tail->count.store(count + 1, std::memory_order_release);
+		}
+
+		/**
+		 * move the steps recorded since the last drain to _out, sorted by time (the steps of a session stay in order)
+		 * can be called while threads record, their new steps are left for the next drain
+		 * @return number of steps appended
+		 */
+		size_t drain(std::vector<Record> &_out)
+		{
+			size_t first = _out.size();
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (auto &lane : lanes_)
+				{
+					Chunk *drained = nullptr;
+					for (;;)
+					{
+						uint32_t count = lane->head->count.load(std::memory_order_acquire);
+						_out.insert(_out.end(), lane->head->records + lane->read, lane->head->records + count);
+						lane->read = count;
+						Chunk *next = count == Chunk::capacity ? lane->head->next.load(std::memory_order_acquire) : nullptr;
+						if (next == nullptr)
+							break;
+						// the thread writes the next chunk only, this one goes back to it
+						lane->head->next.store(drained, std::memory_order_relaxed);
+						drained = lane->head;
+						lane->head = next;
+						lane->read = 0;
+					}
+					// spare chunks the thread did not use since the last drain are dropped, so a burst does not keep its memory
+					if (drained != nullptr || lane->spare.load(std::memory_order_relaxed) != nullptr)
+						release(lane->spare.exchange(drained, std::memory_order_acq_rel));
+				}
+			}
+			std::stable_sort(_out.begin() + first, _out.end(), [](const Record &a, const Record &b) { return a.time < b.time; });
+			return _out.size() - first;
+		}
+
+		/**
+		 * no thread may record anymore
+		 */
+		~Recorder()
+		{
+			for (auto &lane : lanes_)
+			{
+				release(lane->head);
+				release(lane->unused);
+				release(lane->spare.load(std::memory_order_relaxed));
+			}
+		}
+	};
+
+	/**
+	 * @class runtime engine
+	 */
+	class Engine
+	{
+	private:
+		/**
+		 * header of a compiled story file (native byte order)
+		 * followed by treeCount (offset, size) pairs locating the graph images, every image is 8 bytes aligned
+		 */
+		struct StoryHeader
+		{
+			char magic[4]; // "TEST"
+			uint32_t version;
+			uint64_t treeCount;
+		};
+
+		/**
+		 * @class formatted dialogs of one graph, see render()
+		 * a dialog is kept once per set of shown decisions (bit i for decision i of the dialog)
+		 */
+		struct Rendered
+		{
+			std::shared_mutex mutex;
+			const Graph *graph = nullptr;										// graph the blocks were formatted from
+			std::vector<std::vector<std::pair<uint64_t, std::string>>> blocks; // by dialog, then by shown decisions
+		};
+
+		/**
+		 * @class compiled version of a tree, replaced as a whole when the tree is reloaded
+		 */
+		struct Slot
+		{
+			std::shared_ptr<const Graph> graph;		  // current graph, guarded by swap_, sessions share the graphs they are in
+			std::atomic<const Graph *> current{nullptr}; // graph.get(), to detect a reload without locking
+			MappedFile::Stamp stamp;				  // script file when it was last read, unknown for compiled stories
+			bool lazy = false;						  // loaded on demand, can be unloaded
+			std::atomic<uint64_t> used{0};			  // last time a session entered the tree, for lazy trees
+			std::mutex loading;						  // one thread loads a lazy tree, the others wait for it
+			std::atomic<bool> prefetching{false};	  // a background load of the lazy tree is queued, see prefetch()
+			Rendered rendered;						  // dialogs of the current graph, emptied when it is replaced
+			std::shared_ptr<const TextIndex> index;	  // search index of the current graph, guarded by swap_, nullptr until built
+		};
+
+		FlatMap<std::string, Tree *> trees; // trees loaded from a compiled story have no nodes, only an id and a score
+		mutable std::deque<Slot> graphs;	// compiled trees, same index as trees, never moved, lazy trees are loaded by const functions
+		std::vector<MappedFile *> stories;	// mapped compiled stories, graphs point into them
+		mutable std::shared_mutex swap_;	// taken exclusively to replace a tree and its graph
+		mutable std::atomic<uint64_t> clock_{0};  // use counter of lazy trees
+		mutable std::atomic<size_t> resident_{0}; // bytes of graphs of loaded lazy trees
+		mutable std::atomic<size_t> rendered_{0}; // bytes of rendered dialogs
+		mutable std::atomic<uint64_t> sessions_{0}; // sessions numbered so far, see Session::id()
+		std::atomic<Recorder *> recorder_{nullptr}; // receives the steps of all sessions, nullptr = not recording
+		Symbols symbols_;						  // ids and links of all trees
+		configure config;
+
+		/**
+		 * get the current graph of a tree and keep it alive, a lazy tree is loaded if needed
+		 * @return the graph, nullptr if a lazy tree cannot be loaded
+		 */
+		std::shared_ptr<const Graph> pin(uint32_t _tree) const
+		{
+			Slot &slot = graphs[_tree];
+			if (slot.lazy)
+				slot.used.store(++clock_, std::memory_order_relaxed);
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				if (slot.graph || !slot.lazy)
+					return slot.graph;
+			}
+			return fault(_tree);
+		}
+
+		/**
+		 * load a lazy tree on first use, then unload the least recently used trees over budget
+		 * @return the graph, nullptr if the tree cannot be loaded
+		 */
+		std::shared_ptr<const Graph> fault(uint32_t _tree) const
+		{
+			Slot &slot = graphs[_tree];
+			std::lock_guard<std::mutex> loading(slot.loading);
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				if (slot.graph)
+					return slot.graph;
+			}
+
+			const std::string &fname = (trees.begin() + _tree)->first;
+			Graph *graph = nullptr;
+			MappedFile::Stamp stamp;
+			Diagnostics diagnostics;
+			Tree *tree = load(fname, graph, stamp, diagnostics);
+			if (tree == nullptr)
+			{
+				for (auto const &e : diagnostics.entries())
+					console::log<2>("cannot load tree: ", fname, ": ", e.text());
+				return nullptr;
+			}
+			delete tree; // sessions only need the graph, the indexed tree stays a shell
+
+			resolve(*graph);
+			std::shared_ptr<const Graph> pinned(graph);
+			std::shared_ptr<const TextIndex> index(config.search_index ? new TextIndex(*graph) : nullptr);
+			std::unique_lock<std::shared_mutex> lock(swap_);
+			slot.graph = pinned;
+			slot.index = index;
+			slot.current.store(graph, std::memory_order_release);
+			slot.stamp = stamp;
+			resident_ += graph->image().size();
+			if (config.load_budget > 0)
+				evict(_tree);
+			return pinned;
+		}
+
+		/**
+		 * unload the least recently used lazy trees until the budget is met, swap_ must be held exclusively
+		 * trees with sessions in them are skipped, unloading them would not free their graph
+		 * @param _keep tree that is never unloaded
+		 */
+		void evict(uint32_t _keep) const
+		{
+			while (resident_ > config.load_budget)
+			{
+				size_t victim = graphs.size();
+				for (size_t i = 0; i < graphs.size(); i++)
+					if (i != _keep && graphs[i].lazy && graphs[i].graph && graphs[i].graph.use_count() == 1 &&
+						(victim == graphs.size() || graphs[i].used.load(std::memory_order_relaxed) < graphs[victim].used.load(std::memory_order_relaxed)))
+						victim = i;
+				if (victim == graphs.size())
+					return;
+
+				Slot &slot = graphs[victim];
+				resident_ -= slot.graph->image().size();
+				slot.current.store(nullptr, std::memory_order_release);
+				slot.index.reset();
+				slot.graph.reset();
+				forget(slot);
+			}
+		}
+
+		/**
+		 * get the graphs of all loaded trees with their search index, by tree index, indexes that are missing are built on all cores
+		 * trees that are not loaded have neither
+		 */
+		std::vector<std::pair<std::shared_ptr<const Graph>, std::shared_ptr<const TextIndex>>> indexes() const
+		{
+			std::vector<std::pair<std::shared_ptr<const Graph>, std::shared_ptr<const TextIndex>>> all(graphs.size());
+			std::vector<uint32_t> missing;
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				for (uint32_t i = 0; i < all.size(); i++)
+				{
+					all[i] = {graphs[i].graph, graphs[i].index};
+					if (all[i].first && !all[i].second)
+						missing.push_back(i);
+				}
+			}
+			if (missing.empty())
+				return all;
+
+			Workers::run(missing.size(), [&](size_t i) { all[missing[i]].second = std::make_shared<const TextIndex>(*all[missing[i]].first); });
+			std::unique_lock<std::shared_mutex> lock(swap_);
+			for (uint32_t i : missing)
+				if (graphs[i].graph == all[i].first && !graphs[i].index)
+					graphs[i].index = all[i].second;
+			return all;
+		}
+
+		/**
+		 * drop the rendered dialogs of a slot whose graph was replaced
+		 */
+		void forget(Slot &_slot) const
+		{
+			std::unique_lock<std::shared_mutex> lock(_slot.rendered.mutex);
+			rendered_ -= _slot.rendered.blocks.size() * sizeof(_slot.rendered.blocks[0]);
+			for (auto const &blocks : _slot.rendered.blocks)
+				for (auto const &b : blocks)
+					rendered_ -= b.second.size();
+			_slot.rendered.blocks.clear();
+			_slot.rendered.graph = nullptr;
+		}
+
+		/**
+		 * format a dialog and the decisions in _shown, indented like render()
+		 * @param _shown bit i for decision i of the dialog
+		 */
+		std::string format(const Graph &_graph, uint32_t _dialog, uint64_t _shown) const
+		{
+			std::string block(_graph.dialogMessage(_dialog));
+			for (uint32_t d = _graph.firstDecision(_dialog); d < _graph.lastDecision(_dialog); d++)
+			{
+				if (!(_shown >> (d - _graph.firstDecision(_dialog)) & 1))
+					continue;
+				block.push_back('\n');
+				block.append(config.output_indent);
+				block.append(_graph.decisionMessage(d));
+			}
+			block.push_back('\n');
+			return block;
+		}
+
+		/**
+		 * format the current dialog of a session for render(), blocks are passed to _write(std::string_view)
+		 * formatted dialogs are cached per graph unless configure::render_cache_budget is 0
+		 */
+		template <typename Write>
+		void compose(const Session &_session, Write &&_write) const
+		{
+			const Graph *graph = _session.graph_.get();
+			uint32_t first = graph->firstDecision(_session.dialog_), last = graph->lastDecision(_session.dialog_);
+			if (config.render_cache_budget == 0 || last - first > 64)
+			{
+				_write(graph->dialogMessage(_session.dialog_));
+				for (uint32_t d = first; d < last; d++)
+				{
+					if (!config.display_disabled_decisions && !enabled(_session, _session.tree_, d))
+						continue;
+					_write("\n");
+					_write(config.output_indent);
+					_write(graph->decisionMessage(d));
+				}
+				_write("\n");
+				return;
+			}
+
+			// the configuration is fixed for the engine, so a block only depends on the dialog and the shown decisions
+			uint64_t shown = last - first == 64 ? ~uint64_t(0) : (uint64_t(1) << (last - first)) - 1;
+			if (!config.display_disabled_decisions)
+				for (uint32_t d = first; d < last; d++)
+					if (!enabled(_session, _session.tree_, d))
+						shown &= ~(uint64_t(1) << (d - first));
+
+			Rendered &rendered = graphs[_session.tree_].rendered;
+			{
+				std::shared_lock<std::shared_mutex> lock(rendered.mutex);
+				if (rendered.graph == graph && _session.dialog_ < rendered.blocks.size())
+					for (auto const &b : rendered.blocks[_session.dialog_])
+						if (b.first == shown)
+						{
+							_write(b.second);
+							return;
+						}
+			}
+
+			std::string block = format(*graph, _session.dialog_, shown);
+			_write(block);
+			if (rendered_.load(std::memory_order_relaxed) + block.size() > config.render_cache_budget)
+				return;
+
+			// only blocks of the current graph are kept, one of a session still in a replaced graph is not
+			std::unique_lock<std::shared_mutex> lock(rendered.mutex);
+			if (graphs[_session.tree_].current.load(std::memory_order_acquire) != graph)
+				return;
+			if (rendered.graph != graph)
+			{
+				rendered.blocks.assign(graph->dialogCount(), {});
+				rendered.graph = graph;
+				rendered_ += rendered.blocks.size() * sizeof(rendered.blocks[0]);
+			}
+			auto &blocks = rendered.blocks[_session.dialog_];
+			for (auto const &b : blocks)
+				if (b.first == shown)
+					return;
+			rendered_ += block.size();
+			blocks.emplace_back(shown, std::move(block));
+		}
+
+		/**
+		 * get the lazy tree a link enters if it is not loaded, following the link would block on loading it
+		 * @return the tree index, Graph::npos if the link can be followed at once
+		 */
+		uint32_t unloaded(const Graph &_graph, Graph::Link _link) const
+		{
+			if (_link.type != Graph::LinkType::tree)
+				return Graph::npos;
+			uint32_t tree = resolve(_graph, _link.target); // normalized and relative ids, like follow()
+			if (tree == Graph::npos || !graphs[tree].lazy || graphs[tree].current.load(std::memory_order_acquire) != nullptr)
+				return Graph::npos;
+			return tree;
+		}
+
+		/**
+		 * get the link a step follows, the dialog link for Step::next
+		 */
+		static Graph::Link stepLink(const Session &_session, uint32_t _decision)
+		{
+			const Graph &graph = *_session.graph_;
+			if (_decision == UINT32_MAX)
+				return graph.dialogLink(_session.dialog_);
+			uint32_t decision = graph.firstDecision(_session.dialog_) + _decision;
+			return decision < graph.lastDecision(_session.dialog_) ? graph.decisionLink(decision) : Graph::Link();
+		}
+
+		/**
+		 * find the dialog a decision belongs to
+		 */
+		static uint32_t dialogOf(const Graph &_graph, uint32_t _decision)
+		{
+			uint32_t low = 0, high = _graph.dialogCount();
+			while (high - low > 1)
+			{
+				uint32_t mid = low + (high - low) / 2;
+				if (_graph.firstDecision(mid) <= _decision)
+					low = mid;
+				else
+					high = mid;
+			}
+			return low;
+		}
+
+		/**
+		 * find the same decision in another version of a graph, by dialog id and decision id
+		 * @return the decision index in _to, Graph::npos if it was removed
+		 */
+		static uint32_t translate(const Graph &_from, uint32_t _decision, const Graph &_to)
+		{
+			uint32_t dialog = _to.find(_from.dialogId(dialogOf(_from, _decision)));
+			if (dialog == Graph::npos)
+				return Graph::npos;
+			for (uint32_t d = _to.firstDecision(dialog); d < _to.lastDecision(dialog); d++)
+				if (_to.decisionId(d) == _from.decisionId(_decision))
+					return d;
+			return Graph::npos;
+		}
+
+		/**
+		 * move the decision overrides of a tree to another version of its graph, overrides of removed decisions are dropped
+		 */
+		static void retarget(Session &_session, uint32_t _tree, const std::shared_ptr<const Graph> &_graph)
+		{
+			if (_tree >= _session.toggled_.size() || _session.toggled_[_tree].bits.empty() || _session.toggled_[_tree].graph == _graph)
+				return;
+
+			Session::Toggles old = std::move(_session.toggled_[_tree]);
+			_session.toggled_[_tree] = Session::Toggles();
+			for (uint32_t d = 0; d < old.graph->decisionCount(); d++)
+			{
+				if (!(old.bits[d / 64] >> (d % 64) & 1))
+					continue;
+				uint32_t moved = translate(*old.graph, d, *_graph);
+				if (moved != Graph::npos)
+					_session.toggle(_tree, moved, _graph);
+			}
+		}
+
+		/**
+		 * whether a decision can be chosen in a session, see the public enabled()
+		 * @param _graph graph of the tree the decision index refers to, kept alive by the caller
+		 */
+		bool enabled(const Session &_session, uint32_t _tree, uint32_t _decision, const Graph &_graph) const
+		{
+			if (_tree >= _session.toggled_.size() || _session.toggled_[_tree].bits.empty() || _session.toggled_[_tree].graph.get() == &_graph)
+				return _graph.decisionEnabled(_decision) != _session.toggled(_tree, _decision);
+
+			// overrides made before the tree was reloaded
+			uint32_t old = translate(_graph, _decision, *_session.toggled_[_tree].graph);
+			return _graph.decisionEnabled(_decision) != (old != Graph::npos && _session.toggled(_tree, old));
+		}
+
+		/**
+		 * move a session to the root of a tree
+		 */
+		bool enter(Session &_session, uint32_t _tree) const
+		{
+			_session.tree_ = _tree;
+			if (_tree < graphs.size() && (_session.graph_ = pin(_tree)))
+			{
+				_session.dialog_ = _session.graph_->root();
+				retarget(_session, _tree, _session.graph_);
+			}
+			else
+			{
+				_session.graph_.reset();
+				_session.dialog_ = Graph::npos;
+			}
+			return !_session.done();
+		}
+
+		/**
+		 * move a session to a dialog of a tree, where a recorded step was made
+		 * @return false and the session is done if the tree or the dialog does not exist
+		 */
+		bool place(Session &_session, uint32_t _tree, uint32_t _dialog) const
+		{
+			if (!enter(_session, _tree))
+				return false;
+			if (_dialog >= _session.graph_->dialogCount())
+			{
+				_session.graph_.reset();
+				_session.dialog_ = Graph::npos;
+				return false;
+			}
+			_session.dialog_ = _dialog;
+			return true;
+		}
+
+		/**
+		 * move a session to the latest graph of its tree if the tree was reloaded, the dialog is found again by id
+		 * a session whose dialog was removed goes back to the root of the tree
+		 */
+		void refresh(Session &_session) const
+		{
+			if (_session.done())
+				return;
+			const Graph *current = graphs[_session.tree_].current.load(std::memory_order_acquire);
+			if (_session.graph_.get() == current || current == nullptr) // an unloaded lazy tree has no newer version
+				return;
+
+			std::shared_ptr<const Graph> graph = pin(_session.tree_);
+			uint32_t dialog = graph->find(_session.graph_->dialogId(_session.dialog_));
+			if (dialog == Graph::npos)
+			{
+				console::log<2>("dialog removed by reload, back to the root: ", _session.graph_->dialogId(_session.dialog_));
+				dialog = graph->root();
+			}
+			retarget(_session, _session.tree_, graph);
+			_session.graph_ = std::move(graph);
+			_session.dialog_ = dialog;
+		}
+
+		/**
+		 * find a tree by id, the id is normalized if it is not found as is
+		 * @return the tree index, trees.npos if there is none
+		 */
+		size_t find(std::string_view _id) const
+		{
+			size_t i = trees.indexOf(_id);
+			if (i != trees.npos)
+				return i;
+			std::string id = normalize(_id);
+			return id == _id ? trees.npos : trees.indexOf(id);
+		}
+
+		/**
+		 * get the tree a tree link of a graph enters, resolved once then kept in the graph
+		 * the link is a tree id, or a path relative to the directory of the linking tree
+		 * @return the tree index, Graph::npos if the tree is not loaded
+		 */
+		uint32_t resolve(const Graph &_graph, uint32_t _link) const
+		{
+			uint32_t tree = _graph.linkedTree(_link);
+			if (tree != Graph::npos)
+				return tree;
+
+			std::string_view target = _graph.treeLink(_link);
+			size_t i = find(target);
+			size_t slash = _graph.id().rfind('/');
+			if (i == trees.npos && slash != std::string_view::npos && !target.empty() && target[0] != '/')
+				i = trees.indexOf(normalize(std::string(_graph.id().substr(0, slash + 1)).append(target)));
+			if (i == trees.npos)
+				return Graph::npos; // the tree can still be added later
+			_graph.linkTree(_link, (uint32_t)i);
+			return (uint32_t)i;
+		}
+
+		/**
+		 * resolve every tree link of a new graph, links to trees added later are resolved when followed
+		 */
+		void resolve(const Graph &_graph) const
+		{
+			for (uint32_t l = 0; l < _graph.treeLinkCount(); l++)
+				resolve(_graph, l);
+		}
+
+		/**
+		 * follow a compiled link from the current graph of a session
+		 * @return whether the session can continue
+		 */
+		bool follow(Session &_session, Graph::Link _link) const
+		{
+			switch (_link.type)
+			{
+			case Graph::LinkType::dialog:
+				_session.dialog_ = _link.target;
+				return true;
+			case Graph::LinkType::tree:
+			{
+				uint32_t tree = resolve(*_session.graph_, _link.target);
+				if (tree == Graph::npos)
+					console::log<2>("cannot find tree with id: ", _session.graph_->treeLink(_link.target));
+				return enter(_session, tree);
+			}
+			default:
+				_session.dialog_ = Graph::npos;
+				return false;
+			}
+		}
+
+		/**
+		 * parse and compile a script file, independent of the engine state
+		 * @param stamp receive the stamp of the file that was read
+		 * @return the tree, nullptr if the file has no dialog or has errors
+		 */
+		Tree *load(const std::string &fname, Graph *&graph, MappedFile::Stamp &stamp, Diagnostics &diagnostics) const
+		{
+			uint64_t begin = Metrics::now();
+			MappedFile file(fname);
+			Metrics::time(Metrics::io, begin);
+			if (!file.isOpen())
+			{
+				diagnostics.report<1>(0, "cannot open file: ", fname);
+				return nullptr;
+			}
+			stamp = file.stamp();
+
+			Tree *tree = Parser::create(config, normalize(fname), file.view(), diagnostics);
+			if (!diagnostics.ok())
+			{
+				delete tree;
+				return nullptr;
+			}
+			if (tree == nullptr)
+				diagnostics.report<2>(0, "no dialog found in file: ", fname);
+			else
+				graph = new Graph(*tree);
+			return tree;
+		}
+
+		/**
+		 * parse and compile a script file, warnings are logged
+		 * @exception cannot open file, the first error of the script
+		 */
+		Tree *load(const std::string &fname, Graph *&graph, MappedFile::Stamp &stamp) const
+		{
+			Diagnostics diagnostics(false);
+			Tree *tree = load(fname, graph, stamp, diagnostics);
+			diagnostics.raise();
+			return tree;
+		}
+
+		/**
+		 * add a loaded tree and its graph, the engine takes ownership
+		 * @exception duplicate tree id
+		 */
+		void insert(const std::string &fname, Tree *tree, Graph *graph, const MappedFile::Stamp &stamp = {})
+		{
+			if (tree == nullptr)
+				return;
+			if (trees.emplace(normalize(fname), tree).second == false)
+			{
+				delete graph;
+				delete tree;
+				console::log<1>("duplicate tree id: ", fname);
+			}
+			Slot &slot = graphs.emplace_back();
+			slot.graph.reset(graph);
+			slot.current.store(graph, std::memory_order_release);
+			slot.stamp = stamp;
+			if (config.search_index)
+				slot.index = std::make_shared<const TextIndex>(*graph);
+			tree->intern(symbols_);
+			resolve(*graph);
+		}
+
+		/**
+		 * replace the graph of a tree, and the tree unless _tree is nullptr
+		 * sessions keep using the old graph until their next step, the old graph is freed by the last of them
+		 */
+		void publish(size_t _index, Tree *_tree, Graph *_graph)
+		{
+			resolve(*_graph);
+			std::shared_ptr<const Graph> graph(_graph);
+			std::shared_ptr<const TextIndex> index(config.search_index ? new TextIndex(*_graph) : nullptr);
+			Tree *old = nullptr;
+			{
+				std::unique_lock<std::shared_mutex> lock(swap_);
+				if (graphs[_index].lazy) // an unloaded lazy tree holds no bytes yet
+					resident_ += _graph->image().size() - (graphs[_index].graph ? graphs[_index].graph->image().size() : 0);
+				if (_tree != nullptr)
+				{
+					old = (trees.begin() + _index)->second;
+					(trees.begin() + _index)->second = _tree;
+				}
+				graphs[_index].graph.swap(graph);
+				graphs[_index].index.swap(index);
+				graphs[_index].current.store(_graph, std::memory_order_release);
+				forget(graphs[_index]);
+				if (graphs[_index].lazy && config.load_budget > 0)
+					evict((uint32_t)_index);
+			}
+			delete old;
+		}
+
+		/**
+		 * add a loaded tree and its graph unless the file has errors or the tree id is taken
+		 * @return whether the tree was added
+		 */
+		bool add(const std::string &fname, Tree *tree, Graph *graph, const MappedFile::Stamp &stamp, Diagnostics &diagnostics)
+		{
+			if (diagnostics.ok() && tree != nullptr && trees.indexOf(normalize(fname)) != trees.npos)
+				diagnostics.report<1>(0, "duplicate tree id: ", fname);
+			if (!diagnostics.ok())
+			{
+				delete graph;
+				delete tree;
+				return false;
+			}
+			insert(fname, tree, graph, stamp);
+			return true;
+		}
+
+		/**
+		 * get the target of a link as an id, dialog indices differ between versions of a graph
+		 */
+		static std::string_view linkName(const Graph &_graph, Graph::Link _link)
+		{
+			switch (_link.type)
+			{
+			case Graph::LinkType::dialog:
+				return _graph.dialogId(_link.target);
+			case Graph::LinkType::tree:
+				return _graph.treeLink(_link.target);
+			case Graph::LinkType::missing:
+				return _graph.missingLink(_link.target);
+			default:
+				return "";
+			}
+		}
+
+		/**
+		 * whether a dialog and its decisions are the same in two versions of a graph
+		 */
+		static bool same(const Graph &_old, uint32_t _o, const Graph &_new, uint32_t _n)
+		{
+			auto sameLink = [&](Graph::Link a, Graph::Link b) { return a.type == b.type && linkName(_old, a) == linkName(_new, b); };
+			if (_old.dialogMessage(_o) != _new.dialogMessage(_n) || !sameLink(_old.dialogLink(_o), _new.dialogLink(_n)) ||
+				_old.lastDecision(_o) - _old.firstDecision(_o) != _new.lastDecision(_n) - _new.firstDecision(_n))
+				return false;
+			for (uint32_t a = _old.firstDecision(_o), b = _new.firstDecision(_n); a < _old.lastDecision(_o); a++, b++)
+				if (_old.decisionId(a) != _new.decisionId(b) || _old.decisionMessage(a) != _new.decisionMessage(b) ||
+					!sameLink(_old.decisionLink(a), _new.decisionLink(b)) ||
+					_old.decisionEnabled(a) != _new.decisionEnabled(b) || _old.decisionScore(a) != _new.decisionScore(b))
+					return false;
+			return true;
+		}
+
+		/**
+		 * collect the enabled decisions of the current dialog of a session
+		 * @param _options receive the indices of the enabled decisions within the dialog
+		 * @return number of decisions of the dialog, enabled or not
+		 */
+		uint32_t options(const Session &_session, std::vector<uint32_t> &_options) const
+		{
+			const Graph *graph = _session.graph_.get();
+			uint32_t first = graph->firstDecision(_session.dialog_), last = graph->lastDecision(_session.dialog_);
+			_options.clear();
+			for (uint32_t d = first; d < last; d++)
+				if (enabled(_session, _session.tree_, d))
+					_options.push_back(d - first);
+			return last - first;
+		}
+
+		/**
+		 * play a walk until it ends, is stopped by the policy or runs out of steps
+		 */
+		template <typename Policy>
+		void play(Session &_session, Walk &_walk, const Policy &_policy, uint32_t _max_steps, std::vector<uint32_t> &_options) const
+		{
+			while (!_session.done() && _walk.step < _max_steps)
+			{
+				if (!options(_session, _options))
+				{
+					next(_session);
+					_walk.step++;
+					continue;
+				}
+				if (_options.empty())
+					return;
+				uint32_t choice = _policy(_walk, _session, *_session.graph_, (uint32_t)_options.size());
+				if (choice >= _options.size())
+					return;
+				choose(_session, _options[choice]);
+				_walk.step++;
+				_walk.choices++;
+			}
+		}
+
+		static constexpr char snapshotMagic[4] = {'T', 'E', 'S', 'S'};
+		static constexpr uint8_t snapshotVersion = 1;
+		static constexpr char logMagic[4] = {'T', 'E', 'S', 'L'};
+		static constexpr uint8_t logVersion = 1;
+
+		/**
+		 * append an unsigned integer to a snapshot, 7 bits per byte
+		 */
+		static void putVarint(std::string &_out, uint64_t _value)
+		{
+			while (_value >= 0x80)
+			{
+				_out.push_back(char(_value | 0x80));
+				_value >>= 7;
+			}
+			_out.push_back(char(_value));
+		}
+
+		/**
+		 * append an id to a snapshot, its size then its characters
+		 */
+		static void putId(std::string &_out, std::string_view _id)
+		{
+			putVarint(_out, _id.size());
+			_out.append(_id);
+		}
+
+		/**
+		 * @class read a snapshot written by save(), or a replay log written by saveLog()
+		 * @exception invalid session snapshot (or error), on truncated or malformed data
+		 */
+		struct SnapshotReader
+		{
+			const char *it;
+			const char *end;
+			const char *error = "invalid session snapshot";
+
+			uint64_t varint()
+			{
+				uint64_t value = 0;
+				for (int shift = 0; shift < 64; shift += 7)
+				{
+					if (it == end)
+						break;
+					uint8_t byte = (uint8_t)*it++;
+					value |= uint64_t(byte & 0x7f) << shift;
+					if (!(byte & 0x80))
+						return value;
+				}
+				console::log<1>(error);
+				return 0;
+			}
+
+			std::string_view id()
+			{
+				uint64_t size = varint();
+				if (size > uint64_t(end - it))
+					console::log<1>(error);
+				std::string_view id(it, size);
+				it += size;
+				return id;
+			}
+		};
+
+		/**
+		 * find a dialog by id, trying the index it had when saved first
+		 * @param _hint dialog index when saved
+		 */
+		static uint32_t findDialog(const Graph &_graph, uint64_t _hint, std::string_view _id)
+		{
+			if (_hint < _graph.dialogCount() && _graph.dialogId((uint32_t)_hint) == _id)
+				return (uint32_t)_hint;
+			return _graph.find(_id);
+		}
+
+		/**
+		 * find a decision by dialog id and decision id, trying the index it had when saved first
+		 * @param _hint decision index when saved
+		 */
+		static uint32_t findDecision(const Graph &_graph, uint64_t _hint, std::string_view _dialog, std::string_view _id)
+		{
+			if (_hint < _graph.decisionCount() && _graph.decisionId((uint32_t)_hint) == _id && _graph.dialogId(dialogOf(_graph, (uint32_t)_hint)) == _dialog)
+				return (uint32_t)_hint;
+			uint32_t dialog = _graph.find(_dialog);
+			if (dialog != Graph::npos)
+				for (uint32_t d = _graph.firstDecision(dialog); d < _graph.lastDecision(dialog); d++)
+					if (_graph.decisionId(d) == _id)
+						return d;
+			return Graph::npos;
+		}
+
+		/**
+		 * add the trees of a compiled story, all or none: every graph is checked, on all cores, and every id before a tree is added
+		 * @exception invalid story file, duplicate tree id
+		 */
+		void attach(std::string_view _story, const std::string &_name)
+		{
+			const StoryHeader *header = reinterpret_cast<const StoryHeader *>(_story.data());
+			if (_story.size() < sizeof(StoryHeader) || reinterpret_cast<uintptr_t>(_story.data()) % 8 != 0 || std::memcmp(header->magic, "TEST", 4) != 0 ||
+				header->version != Graph::version || header->treeCount > (_story.size() - sizeof(StoryHeader)) / (2 * sizeof(uint64_t)))
+				console::log<1>("invalid story file: ", _name);
+
+			const uint64_t *entries = reinterpret_cast<const uint64_t *>(header + 1);
+			std::vector<std::unique_ptr<Graph>> compiled(header->treeCount);
+			Workers::run(compiled.size(), [&](size_t i) {
+				uint64_t offset = entries[2 * i], size = entries[2 * i + 1];
+				if (offset > _story.size() || size > _story.size() - offset)
+					console::log<1>("invalid story file: ", _name);
+				compiled[i].reset(new Graph(_story.data() + offset, size));
+			});
+
+			FlatMap<std::string, uint32_t> ids;
+			for (auto const &g : compiled)
+				if (std::string id = normalize(g->id()); trees.indexOf(id) != trees.npos || !ids.emplace(id, 0).second)
+					console::log<1>("duplicate tree id: ", g->id());
+			for (auto &g : compiled)
+			{
+				std::string id(g->id());
+				const Graph *graph = g.get();
+				insert(id, new Tree(id, graph->root() == Graph::npos ? "" : std::string(graph->dialogId(graph->root()))), g.release());
+			}
+		}
+
+		/**
+		 * number the strongly connected components of a graph in reverse topological order (iterative tarjan)
+		 * @param first node i links to targets [first[i], first[i + 1]), first has one entry per node plus one
+		 * @param targets target node of every link, Graph::npos for a link that ends the game
+		 * @param component receive the component of every node, a link never goes to a higher component
+		 * @return number of components
+		 */
+		static uint32_t condense(const std::vector<uint32_t> &first, const std::vector<uint32_t> &targets, std::vector<uint32_t> &component)
+		{
+			uint32_t nodes = (uint32_t)first.size() - 1, components = 0, counter = 0;
+			std::vector<uint32_t> index(nodes, Graph::npos), low(nodes), stack;
+			std::vector<uint8_t> onStack(nodes, 0);
+			std::vector<std::pair<uint32_t, uint32_t>> calls; // node and next link to visit
+			component.assign(nodes, 0);
+			auto visit = [&](uint32_t n) {
+				index[n] = low[n] = counter++;
+				stack.push_back(n);
+				onStack[n] = 1;
+				calls.push_back({n, first[n]});
+			};
+			for (uint32_t s = 0; s < nodes; s++)
+			{
+				if (index[s] != Graph::npos)
+					continue;
+				visit(s);
+				while (!calls.empty())
+				{
+					uint32_t n = calls.back().first;
+					if (calls.back().second < first[n + 1])
+					{
+						uint32_t m = targets[calls.back().second++];
+						if (m == Graph::npos)
+							continue;
+						if (index[m] == Graph::npos)
+							visit(m);
+						else if (onStack[m])
+							low[n] = std::min(low[n], index[m]);
+						continue;
+					}
+
+					calls.pop_back();
+					if (!calls.empty())
+						low[calls.back().first] = std::min(low[calls.back().first], low[n]);
+					if (low[n] != index[n])
+						continue;
+					uint32_t m;
+					do
+					{
+						m = stack.back();
+						stack.pop_back();
+						onStack[m] = 0;
+						component[m] = components;
+					} while (m != n);
+					components++;
+				}
+			}
+			return components;
+		}
+
+	public:
+		/**
+		 * @class dialogs changed by a reload, by id
+		 */
+		struct Changes
+		{
+			std::vector<std::string> added;
+			std::vector<std::string> removed;
+			std::vector<std::string> modified; // message, link or decisions changed
+
+			/**
+			 * whether the dialogs are the same (the root may still differ)
+			 */
+			inline bool empty() const { return added.empty() && removed.empty() && modified.empty(); }
+		};
+
+		/**
+		 * @class result of a whole story link analysis, see analyze()
+		 * dialogs of all trees are numbered in tree order: node = offsets[tree] + dialog
+		 */
+		struct Analysis
+		{
+			static constexpr uint32_t end = Graph::npos; // target of a link that ends the game
+
+			/**
+			 * a dialog of a tree
+			 */
+			struct Node
+			{
+				uint32_t tree;
+				uint32_t dialog;
+			};
+
+			/**
+			 * a link whose target does not exist
+			 */
+			struct Dangling
+			{
+				Node from;
+				uint32_t decision; // decision index in the graph, Graph::npos for the link of the dialog
+				Graph::LinkType type;
+				std::string target; // id of the missing dialog or tree
+			};
+
+			/**
+			 * a strongly connected component with more than one dialog, or a dialog linking to itself
+			 */
+			struct Cycle
+			{
+				std::vector<Node> nodes;
+				bool closed; // no link leaves the cycle and none of its dialogs ends the game, a player entering it can never finish
+			};
+
+			std::vector<uint32_t> offsets;	 // first node of every tree, plus the total number of nodes
+			std::vector<uint32_t> first;	 // node i links to targets [first[i], first[i + 1])
+			std::vector<uint32_t> targets;	 // target node of every link, end if it ends the game (dangling links too)
+			std::vector<uint32_t> component; // strongly connected component of every node, numbered in reverse topological order
+			uint32_t components = 0;		 // number of strongly connected components
+
+			std::vector<Dangling> dangling;
+			std::vector<Node> unreachable; // dialogs that cannot be reached from any entry
+			std::vector<Cycle> cycles;
+
+			/**
+			 * get the node of a dialog
+			 */
+			inline uint32_t node(uint32_t _tree, uint32_t _dialog) const { return offsets[_tree] + _dialog; }
+		};
+
+		/**
+		 * @class endings and total scores reachable from the first dialog of a tree, see outcomes()
+		 */
+		struct Outcome
+		{
+			static constexpr uint64_t unbounded = UINT64_MAX; // paths of a tree whose walks can loop before the game ends
+
+			uint64_t endings = 0;		// links ending the game a walk can take: decisions without link, dialogs without decision and link
+			uint64_t paths = 0;			// distinct walks to an end of the game, unbounded if a walk can loop (or past 2^64 - 2)
+			int64_t minScore = 0;		// lowest total score at an end of the game, with the initial scores of all trees, 0 if it cannot end
+			int64_t maxScore = 0;		// highest total score at an end of the game
+			bool unboundedMin = false;	// a loop lowering the score can be repeated at will before the game ends, minScore is not the lowest
+			bool unboundedMax = false;	// a loop raising the score can be repeated at will before the game ends, maxScore is not the highest
+		};
+
+		/**
+		 * resolve every link of every tree and analyse the story graph, in linear time of dialogs and decisions
+		 * a dialog with decisions links through them, a dialog without decisions through its own link (see next() and choose())
+		 * disabled decisions are included, sessions can enable them; lazy trees are loaded (over the budget if needed)
+		 * @param _entries ids of the trees the game can start in, default = empty (every tree)
+		 */
+		Analysis analyze(const std::vector<std::string> &_entries = {}) const
+		{
+			Analysis a;
+			std::vector<std::shared_ptr<const Graph>> pinned(graphs.size());
+			a.offsets.resize(graphs.size() + 1, 0);
+			for (uint32_t t = 0; t < graphs.size(); t++)
+			{
+				pinned[t] = pin(t);
+				a.offsets[t + 1] = a.offsets[t] + (pinned[t] ? pinned[t]->dialogCount() : 0);
+			}
+			auto root = [&](size_t t) { return t < graphs.size() && pinned[t] && pinned[t]->root() != Graph::npos ? a.node((uint32_t)t, pinned[t]->root()) : Analysis::end; };
+
+			// links into a tree go to its root
+			uint32_t nodes = a.offsets.back();
+			a.first.reserve(nodes + 1);
+			for (uint32_t t = 0; t < graphs.size(); t++)
+			{
+				const Graph *g = pinned[t].get();
+				if (g == nullptr)
+					continue;
+				std::vector<uint32_t> roots(g->treeLinkCount());
+				for (uint32_t l = 0; l < g->treeLinkCount(); l++)
+					roots[l] = root(resolve(*g, l));
+
+				auto add = [&](uint32_t d, uint32_t decision, Graph::Link link) {
+					uint32_t target = Analysis::end;
+					if (link.type == Graph::LinkType::dialog)
+						target = a.node(t, link.target);
+					else if (link.type == Graph::LinkType::tree && (target = roots[link.target]) == Analysis::end)
+						a.dangling.push_back({{t, d}, decision, link.type, std::string(g->treeLink(link.target))});
+					else if (link.type == Graph::LinkType::missing)
+						a.dangling.push_back({{t, d}, decision, link.type, std::string(g->missingLink(link.target))});
+					a.targets.push_back(target);
+				};
+				for (uint32_t d = 0; d < g->dialogCount(); d++)
+				{
+					a.first.push_back((uint32_t)a.targets.size());
+					for (uint32_t de = g->firstDecision(d); de < g->lastDecision(d); de++)
+						add(d, de, g->decisionLink(de));
+					if (g->firstDecision(d) == g->lastDecision(d))
+						add(d, Graph::npos, g->dialogLink(d));
+				}
+			}
+			a.first.push_back((uint32_t)a.targets.size());
+
+			// reachability from the entries
+			std::vector<uint8_t> reached(nodes, 0);
+			std::vector<uint32_t> stack;
+			auto reach = [&](uint32_t n) {
+				if (n != Analysis::end && !reached[n])
+					reached[n] = 1, stack.push_back(n);
+			};
+			if (_entries.empty())
+				for (uint32_t t = 0; t < graphs.size(); t++)
+					reach(root(t));
+			for (auto const &e : _entries)
+				reach(root(find(e)));
+			while (!stack.empty())
+			{
+				uint32_t n = stack.back();
+				stack.pop_back();
+				for (uint32_t e = a.first[n]; e < a.first[n + 1]; e++)
+					reach(a.targets[e]);
+			}
+
+			a.components = condense(a.first, a.targets, a.component);
+
+			// cycles, and whether a player can leave them
+			std::vector<uint32_t> size(a.components, 0);
+			std::vector<uint8_t> loop(a.components, 0), open(a.components, 0);
+			for (uint32_t n = 0; n < nodes; n++)
+			{
+				uint32_t c = a.component[n];
+				size[c]++;
+				for (uint32_t e = a.first[n]; e < a.first[n + 1]; e++)
+				{
+					uint32_t m = a.targets[e];
+					if (m == n)
+						loop[c] = 1;
+					if (m == Analysis::end || a.component[m] != c)
+						open[c] = 1;
+				}
+			}
+			std::vector<uint32_t> cycle(a.components, Analysis::end);
+			for (uint32_t c = 0; c < a.components; c++)
+				if (size[c] > 1 || loop[c])
+				{
+					cycle[c] = (uint32_t)a.cycles.size();
+					a.cycles.push_back({{}, !open[c]});
+					a.cycles.back().nodes.reserve(size[c]);
+				}
+
+			for (uint32_t t = 0; t < graphs.size(); t++)
+				for (uint32_t d = 0; d < a.offsets[t + 1] - a.offsets[t]; d++)
+				{
+					uint32_t n = a.node(t, d);
+					if (!reached[n])
+						a.unreachable.push_back({t, d});
+					if (cycle[a.component[n]] != Analysis::end)
+						a.cycles[cycle[a.component[n]]].nodes.push_back({t, d});
+				}
+			return a;
+		}
+
+		/**
+		 * get the endings and the range of total scores of the walks from the first dialog of every tree, without enumerating them
+		 * walks take the enabled decisions of the story (sessions can toggle them) and end like sessions: at a link that ends the game
+		 * loops are collapsed: the story is condensed into its strongly connected components and every dialog is solved once, after the
+		 * components it links to; inside a component the scores are relaxed until they settle, scores still rising after as many sweeps
+		 * as the component has dialogs (at most 2^26 relaxations) come from a loop that can be repeated and are reported unbounded
+		 * links are collected per tree and endings counted per 64 trees on all cores, lazy trees are loaded (over the budget if needed)
+		 * @param _threads number of threads, default = 0 (hardware concurrency)
+		 * @return outcome of every tree, by tree index
+		 */
+		std::vector<Outcome> outcomes(unsigned _threads = 0) const
+		{
+			uint32_t count = (uint32_t)graphs.size();
+			std::vector<std::shared_ptr<const Graph>> pinned(count);
+			std::vector<uint32_t> offsets(count + 1, 0);
+			int64_t initial = 0;
+			for (uint32_t t = 0; t < count; t++)
+			{
+				pinned[t] = pin(t);
+				offsets[t + 1] = offsets[t] + (pinned[t] ? pinned[t]->dialogCount() : 0);
+			}
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				for (auto const &t : trees)
+					initial += t.second->score();
+			}
+			auto root = [&](uint32_t t) { return t < count && pinned[t] && pinned[t]->root() != Graph::npos ? offsets[t] + pinned[t]->root() : Graph::npos; };
+
+			// enabled links of every tree, links into a tree go to its root
+			struct Links
+			{
+				std::vector<uint32_t> first, targets;
+				std::vector<int32_t> scores;
+			};
+			std::vector<Links> parts(count);
+			Workers::run(count, [&](size_t t) {
+				const Graph *g = pinned[t].get();
+				if (g == nullptr)
+					return;
+				Links &l = parts[t];
+				std::vector<uint32_t> roots(g->treeLinkCount());
+				for (uint32_t i = 0; i < g->treeLinkCount(); i++)
+					roots[i] = root(resolve(*g, i));
+				auto add = [&](Graph::Link link, int score) {
+					uint32_t target = Graph::npos;
+					if (link.type == Graph::LinkType::dialog)
+						target = offsets[t] + link.target;
+					else if (link.type == Graph::LinkType::tree)
+						target = roots[link.target];
+					l.targets.push_back(target);
+					l.scores.push_back(score);
+				};
+				for (uint32_t d = 0; d < g->dialogCount(); d++)
+				{
+					l.first.push_back((uint32_t)l.targets.size());
+					if (g->firstDecision(d) == g->lastDecision(d))
+						add(g->dialogLink(d), 0);
+					for (uint32_t de = g->firstDecision(d); de < g->lastDecision(d); de++)
+						if (g->decisionEnabled(de))
+							add(g->decisionLink(de), g->decisionScore(de));
+				}
+			}, _threads);
+
+			uint32_t nodes = offsets.back();
+			std::vector<uint32_t> first, targets;
+			std::vector<int32_t> scores;
+			first.reserve(nodes + 1);
+			for (auto &l : parts)
+			{
+				for (uint32_t f : l.first)
+					first.push_back((uint32_t)targets.size() + f);
+				targets.insert(targets.end(), l.targets.begin(), l.targets.end());
+				scores.insert(scores.end(), l.scores.begin(), l.scores.end());
+				l = Links();
+			}
+			first.push_back((uint32_t)targets.size());
+
+			// nodes grouped by component, sinks first
+			std::vector<uint32_t> component;
+			uint32_t components = condense(first, targets, component);
+			std::vector<uint32_t> start(components + 1, 0), order(nodes);
+			for (uint32_t n = 0; n < nodes; n++)
+				start[component[n] + 1]++;
+			for (uint32_t c = 0; c < components; c++)
+				start[c + 1] += start[c];
+			{
+				std::vector<uint32_t> next(start.begin(), start.end() - 1);
+				for (uint32_t n = 0; n < nodes; n++)
+					order[next[component[n]]++] = n;
+			}
+
+			// solve every component once the components it links to are solved
+			enum : uint8_t
+			{
+				ends = 1,	 // the game can end from the node, lo and hi are set
+				falling = 2, // the lowest score is unbounded
+				rising = 4	 // the highest score is unbounded
+			};
+			std::vector<int64_t> lo(nodes, 0), hi(nodes, 0);
+			std::vector<uint64_t> paths(nodes, 0);
+			std::vector<uint8_t> flags(nodes, 0);
+			auto add = [](uint64_t a, uint64_t b) { return a >= Outcome::unbounded - b ? Outcome::unbounded : a + b; };
+			auto merge = [&](uint32_t n, int64_t l, int64_t h, uint64_t p, uint8_t f) {
+				lo[n] = flags[n] & ends ? std::min(lo[n], l) : l;
+				hi[n] = flags[n] & ends ? std::max(hi[n], h) : h;
+				flags[n] |= f | ends;
+				paths[n] = add(paths[n], p);
+			};
+
+			std::vector<uint32_t> local(nodes), sweep, in, reverse;
+			for (uint32_t c = 0; c < components; c++)
+			{
+				const uint32_t *members = order.data() + start[c];
+				uint32_t size = start[c + 1] - start[c];
+				uint64_t internal = 0;
+				for (uint32_t i = 0; i < size; i++)
+				{
+					uint32_t n = members[i];
+					for (uint32_t e = first[n]; e < first[n + 1]; e++)
+					{
+						uint32_t m = targets[e];
+						if (m == Graph::npos)
+							merge(n, scores[e], scores[e], 1, 0);
+						else if (component[m] == c)
+							internal++;
+						else if (flags[m] & ends)
+							merge(n, scores[e] + lo[m], scores[e] + hi[m], paths[m], flags[m]);
+					}
+				}
+				if (internal == 0)
+					continue;
+
+				// a walk can loop inside the component and reach every link leaving it from every dialog
+				uint8_t reached = 0;
+				for (uint32_t i = 0; i < size; i++)
+					reached |= flags[members[i]];
+				if (!(reached & ends))
+					continue;
+				for (uint32_t i = 0; i < size; i++)
+					paths[members[i]] = Outcome::unbounded;
+
+				// sweep the dialogs from the nearest to the farthest from a link leaving the component
+				for (uint32_t i = 0; i < size; i++)
+					local[members[i]] = i;
+				in.assign(size + 1, 0);
+				for (uint32_t i = 0; i < size; i++)
+					for (uint32_t e = first[members[i]]; e < first[members[i] + 1]; e++)
+						if (targets[e] != Graph::npos && component[targets[e]] == c)
+							in[local[targets[e]] + 1]++;
+				for (uint32_t i = 0; i < size; i++)
+					in[i + 1] += in[i];
+				reverse.resize(internal);
+				{
+					std::vector<uint32_t> next(in.begin(), in.end() - 1);
+					for (uint32_t i = 0; i < size; i++)
+						for (uint32_t e = first[members[i]]; e < first[members[i] + 1]; e++)
+							if (targets[e] != Graph::npos && component[targets[e]] == c)
+								reverse[next[local[targets[e]]]++] = members[i];
+				}
+				sweep.clear();
+				for (uint32_t i = 0; i < size; i++)
+					if (flags[members[i]] & ends)
+						sweep.push_back(members[i]);
+				for (size_t i = 0; i < sweep.size(); i++)
+					for (uint32_t r = in[local[sweep[i]]]; r < in[local[sweep[i]] + 1]; r++)
+						if (!(flags[reverse[r]] & ends))
+						{
+							flags[reverse[r]] |= ends;
+							lo[reverse[r]] = std::numeric_limits<int64_t>::max();
+							hi[reverse[r]] = std::numeric_limits<int64_t>::min();
+							sweep.push_back(reverse[r]);
+						}
+
+				uint64_t rounds = std::min<uint64_t>(size, std::max<uint64_t>(1, (uint64_t(1) << 26) / internal));
+				bool lower = true, higher = true;
+				for (uint64_t r = 0; r < rounds && (lower || higher); r++)
+				{
+					lower = higher = false;
+					for (uint32_t n : sweep)
+						for (uint32_t e = first[n]; e < first[n + 1]; e++)
+						{
+							uint32_t m = targets[e];
+							if (m == Graph::npos || component[m] != c || lo[m] > hi[m])
+								continue;
+							if (scores[e] + lo[m] < lo[n])
+								lo[n] = scores[e] + lo[m], lower = true;
+							if (scores[e] + hi[m] > hi[n])
+								hi[n] = scores[e] + hi[m], higher = true;
+						}
+				}
+				reached = (reached & (falling | rising)) | (lower ? falling : 0) | (higher ? rising : 0);
+				for (uint32_t i = 0; i < size; i++)
+					flags[members[i]] |= reached;
+			}
+
+			// endings reachable from every root, for 64 roots at a time: the bits of the roots reaching a component are carried
+			// from the sources to the sinks of the condensed graph, every link is visited once per 64 trees
+			std::vector<Outcome> outcomes(count);
+			Workers::run((count + 63) / 64, [&](size_t b) {
+				uint32_t base = uint32_t(b * 64), end = std::min(count, base + 64);
+				std::vector<uint64_t> reached(components, 0);
+				for (uint32_t t = base; t < end; t++)
+					if (root(t) != Graph::npos)
+						reached[component[root(t)]] |= uint64_t(1) << (t - base);
+				for (uint32_t c = components; c-- > 0;)
+				{
+					uint64_t bits = reached[c];
+					if (bits == 0)
+						continue;
+					for (uint32_t i = start[c]; i < start[c + 1]; i++)
+						for (uint32_t e = first[order[i]]; e < first[order[i] + 1]; e++)
+							if (targets[e] != Graph::npos)
+								reached[component[targets[e]]] |= bits;
+							else
+								for (uint64_t w = bits; w != 0; w &= w - 1)
+									outcomes[base + __builtin_ctzll(w)].endings++;
+				}
+			}, _threads);
+
+			for (uint32_t t = 0; t < count; t++)
+			{
+				uint32_t r = root(t);
+				if (r == Graph::npos)
+					continue;
+				Outcome &o = outcomes[t];
+				o.paths = paths[r];
+				if (flags[r] & ends)
+				{
+					o.minScore = initial + lo[r];
+					o.maxScore = initial + hi[r];
+					o.unboundedMin = flags[r] & falling;
+					o.unboundedMax = flags[r] & rising;
+				}
+			}
+			return outcomes;
+		}
+
+		/**
+		 * compare two versions of a graph dialog by dialog, in linear time
+		 * @return whether the graphs differ
+		 */
+		static bool diff(const Graph &_old, const Graph &_new, Changes &_changes)
+		{
+			FlatMap<std::string, uint32_t> old;
+			old.reserve(_old.dialogCount());
+			for (uint32_t i = 0; i < _old.dialogCount(); i++)
+				old.emplace(_old.dialogId(i), i);
+
+			std::vector<bool> kept(_old.dialogCount(), false);
+			for (uint32_t i = 0; i < _new.dialogCount(); i++)
+			{
+				auto it = old.find(_new.dialogId(i));
+				if (it == old.end())
+					_changes.added.emplace_back(_new.dialogId(i));
+				else
+				{
+					kept[it->second] = true;
+					if (!same(_old, it->second, _new, i))
+						_changes.modified.emplace_back(_new.dialogId(i));
+				}
+			}
+			for (uint32_t i = 0; i < _old.dialogCount(); i++)
+				if (!kept[i])
+					_changes.removed.emplace_back(_old.dialogId(i));
+
+			bool sameRoot = (_old.root() == Graph::npos) == (_new.root() == Graph::npos) &&
+							(_old.root() == Graph::npos || _old.dialogId(_old.root()) == _new.dialogId(_new.root()));
+			return !_changes.empty() || !sameRoot;
+		}
+
+		/**
+		 * normalize a path used as a tree id: `.` segments, repeated and trailing slashes are removed and `..` is applied
+		 * `./tree2`, `tree2` and `story/../tree2` are the same tree, purely lexical (symbolic links are not followed)
+		 */
+		static std::string normalize(std::string_view _path)
+		{
+			bool absolute = !_path.empty() && _path[0] == '/';
+			std::vector<std::string_view> parts;
+			for (size_t i = 0; i <= _path.size();)
+			{
+				size_t j = std::min(_path.find('/', i), _path.size());
+				std::string_view part = _path.substr(i, j - i);
+				if (part == ".." && !parts.empty() && parts.back() != "..")
+					parts.pop_back();
+				else if (part == ".." && !absolute)
+					parts.push_back(part);
+				else if (!part.empty() && part != "." && part != "..")
+					parts.push_back(part);
+				i = j + 1;
+			}
+
+			std::string path = absolute ? "/" : "";
+			for (size_t k = 0; k < parts.size(); k++)
+				path.append(k ? "/" : "").append(parts[k]);
+			return path.empty() ? "." : path;
+		}
+
+		Engine() = default;
+
+		/**
+		 * create an engine with a specific configuration
+		 */
+		Engine(const configure &_config) : config(_config) {}
+
+		/**
+		 * parse a script file into a tree, the file name is the tree id
+		 * @exception cannot open file, duplicate tree id
+		 */
+		void parseScriptFile(const std::string &fname)
+		{
+			Graph *graph = nullptr;
+			MappedFile::Stamp stamp;
+			Tree *tree = load(fname, graph, stamp);
+			insert(fname, tree, graph, stamp);
+		}
+
+		/**
+		 * parse multiple script files concurrently, then add them in the given order
+		 * nothing is added if any file fails or any id is taken, by a loaded tree or by another of the files
+		 * @param _threads number of threads, default = 0 (hardware concurrency)
+		 * @exception cannot open file, duplicate tree id
+		 */
+		void parseScriptFiles(const std::vector<std::string> &fnames, unsigned _threads = 0)
+		{
+			std::vector<Tree *> loaded(fnames.size(), nullptr);
+			std::vector<Graph *> compiled(fnames.size(), nullptr);
+			std::vector<MappedFile::Stamp> stamps(fnames.size());
+			try
+			{
+				Workers::run(fnames.size(), [&](size_t i) { loaded[i] = load(fnames[i], compiled[i], stamps[i]); }, _threads);
+
+				// every id is checked before anything is added
+				std::vector<std::string> ids;
+				for (auto const &fname : fnames)
+					ids.push_back(normalize(fname));
+				std::sort(ids.begin(), ids.end());
+				for (size_t i = 0; i < ids.size(); i++)
+					if (trees.count(ids[i]) != 0 || (i > 0 && ids[i] == ids[i - 1]))
+						console::log<1>("duplicate tree id: ", ids[i]);
+			}
+			catch (...)
+			{
+				for (size_t i = 0; i < fnames.size(); i++)
+				{
+					delete compiled[i];
+					delete loaded[i];
+				}
+				throw;
+			}
+
+			for (size_t i = 0; i < fnames.size(); i++)
+			{
+				try
+				{
+					insert(fnames[i], loaded[i], compiled[i], stamps[i]);
+				}
+				catch (...)
+				{
+					for (size_t j = i + 1; j < fnames.size(); j++)
+					{
+						delete compiled[j];
+						delete loaded[j];
+					}
+					throw;
+				}
+			}
+		}
+
+		/**
+		 * parse a script file into a tree, never throws on script errors
+		 * @param diagnostics receive the errors and warnings of the file
+		 * @return whether the tree was added
+		 */
+		bool parseScriptFile(const std::string &fname, Diagnostics &diagnostics)
+		{
+			Graph *graph = nullptr;
+			MappedFile::Stamp stamp;
+			Tree *tree = load(fname, graph, stamp, diagnostics);
+			return add(fname, tree, graph, stamp, diagnostics);
+		}
+
+		/**
+		 * parse multiple script files concurrently and add every file without errors, in the given order
+		 * never throws on script errors, all files are checked in a single run
+		 * @param diagnostics receive the errors and warnings of every file, same index as fnames
+		 * @param _threads number of threads, default = 0 (hardware concurrency)
+		 * @return whether all trees were added
+		 */
+		bool parseScriptFiles(const std::vector<std::string> &fnames, std::vector<Diagnostics> &diagnostics, unsigned _threads = 0)
+		{
+			diagnostics.assign(fnames.size(), Diagnostics());
+			std::vector<Tree *> loaded(fnames.size(), nullptr);
+			std::vector<Graph *> compiled(fnames.size(), nullptr);
+			std::vector<MappedFile::Stamp> stamps(fnames.size());
+			try
+			{
+				Workers::run(fnames.size(), [&](size_t i) { loaded[i] = load(fnames[i], compiled[i], stamps[i], diagnostics[i]); }, _threads);
+			}
+			catch (...)
+			{
+				for (size_t i = 0; i < fnames.size(); i++)
+				{
+					delete compiled[i];
+					delete loaded[i];
+				}
+				throw;
+			}
+
+			bool added = true;
+			for (size_t i = 0; i < fnames.size(); i++)
+				added &= add(fnames[i], loaded[i], compiled[i], stamps[i], diagnostics[i]);
+			return added;
+		}
+
+		/**
+		 * start parsing a script that arrives in chunks, feed it with Parser::Stream::feed() then add it with parseScriptStream()
+		 * @param _id id of the tree
+		 * @param _diagnostics receive the errors and warnings of the script
+		 */
+		Parser::Stream stream(const std::string &_id, Diagnostics &_diagnostics) const { return Parser::Stream(config, normalize(_id), _diagnostics); }
+
+		/**
+		 * finish a streamed script and add its tree, never throws on script errors
+		 * @return whether the tree was added
+		 */
+		bool parseScriptStream(Parser::Stream &_stream)
+		{
+			Diagnostics &diagnostics = _stream.diagnostics();
+			Tree *tree = _stream.finish();
+			Graph *graph = nullptr;
+			if (diagnostics.ok() && tree == nullptr)
+				diagnostics.report<2>(0, "no dialog found in script: ", _stream.id());
+			else if (diagnostics.ok())
+				graph = new Graph(*tree);
+			return add(_stream.id(), tree, graph, {}, diagnostics);
+		}
+
+		/**
+		 * register script files to be loaded on demand, the file name is the tree id
+		 * a tree is parsed the first time a session enters it, at most configure::load_budget bytes of them stay loaded
+		 * graph() is nullptr for a tree that is not loaded, its tree() entry only has an id and a score
+		 * @exception duplicate tree id
+		 */
+		void indexScriptFiles(const std::vector<std::string> &fnames)
+		{
+			for (auto const &fname : fnames)
+			{
+				std::string id = normalize(fname);
+				if (trees.indexOf(id) != trees.npos)
+					console::log<1>("duplicate tree id: ", fname);
+				Tree *tree = new Tree(id, "");
+				trees.emplace(id, tree);
+				graphs.emplace_back().lazy = true;
+				tree->intern(symbols_);
+			}
+		}
+
+		/**
+		 * get number of bytes of compiled graphs held by trees loaded on demand
+		 */
+		inline size_t residentBytes() const { return resident_.load(std::memory_order_relaxed); }
+
+		/**
+		 * get the instrumentation counters, phase timers and step latencies of the process, see Metrics
+		 * all zero unless built with TEXTENGINE_METRICS=1, Snapshot::json() for a machine readable form
+		 */
+		static Metrics::Snapshot metrics() { return Metrics::snapshot(); }
+
+		/**
+		 * load a compiled story file written by writeStoryFile, the graphs are used directly from the mapped file
+		 * the file is mapped read-only, so every process loading it shares its pages and only keeps its own sessions, caches and
+		 * tree shells: load the same file (on disk or in /dev/shm) from every worker instead of parsing the scripts in each
+		 * @exception cannot open file, invalid story file, duplicate tree id
+		 */
+		void loadStoryFile(const std::string &fname)
+		{
+			MappedFile *file = new MappedFile(fname, MADV_WILLNEED);
+			if (!file->isOpen())
+			{
+				delete file;
+				console::log<1>("cannot open file: ", fname);
+			}
+			try
+			{
+				attach(file->view(), fname);
+			}
+			catch (...)
+			{
+				delete file;
+				throw;
+			}
+			stories.push_back(file);
+		}
+
+		/**
+		 * use a compiled story held in memory, a shared memory segment mapped by the caller for instance, the graphs point into it
+		 * @param _story story written by writeStoryFile, 8 bytes aligned, must stay mapped as long as the engine
+		 * @param _name name of the story in error messages
+		 * @exception invalid story file, duplicate tree id
+		 */
+		void loadStory(std::string_view _story, const std::string &_name = "story") { attach(_story, _name); }
+
+		/**
+		 * write all compiled trees into a story file, which can be loaded with loadStoryFile, the file is replaced atomically
+		 * @exception cannot open file, cannot write file
+		 */
+		void writeStoryFile(const std::string &fname) const
+		{
+			// written next to the target and renamed over it, processes mapping the old file keep using it
+			std::string temporary = fname + "." + std::to_string(::getpid()) + ".tmp";
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				console::log<1>("cannot open file: ", fname);
+
+			StoryHeader header{};
+			std::memcpy(header.magic, "TEST", 4);
+			header.version = Graph::version;
+			header.treeCount = graphs.size();
+
+			// images are placed back to back after the entry table, lazy trees are loaded (and kept until written)
+			std::vector<std::shared_ptr<const Graph>> images;
+			std::vector<uint64_t> entries;
+			uint64_t offset = sizeof(StoryHeader) + graphs.size() * 2 * sizeof(uint64_t);
+			for (uint32_t i = 0; i < graphs.size(); i++)
+			{
+				images.push_back(pin(i));
+				if (!images.back())
+					console::log<1>("cannot load tree: ", (trees.begin() + i)->first);
+				entries.push_back(offset);
+				entries.push_back(images.back()->image().size());
+				offset += images.back()->image().size();
+			}
+
+			file.write(reinterpret_cast<const char *>(&header), sizeof(StoryHeader));
+			file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(uint64_t));
+			for (auto const &g : images)
+				file.write(g->image().data(), g->image().size());
+			file.close();
+			if (!file.good() || std::rename(temporary.c_str(), fname.c_str()) != 0)
+			{
+				std::remove(temporary.c_str());
+				console::log<1>("cannot write file: ", fname);
+			}
+		}
+
+		/**
+		 * (re)compile and intern a tree, call after modifying a parsed tree
+		 * sessions pick up the new graph at their next step, the tree must not be modified while sessions are being started
+		 * @exception cannot find tree with id, tree loaded from a compiled story or on demand
+		 */
+		void compile(const std::string &_id)
+		{
+			size_t i = find(_id);
+			if (i == trees.npos)
+				console::log<1>("cannot find tree with id: ", _id);
+
+			Tree *tree = (trees.begin() + i)->second;
+			if (tree->allDialogs().empty())
+				console::log<1>("tree loaded from a compiled story or on demand cannot be recompiled: ", _id);
+
+			tree->intern(symbols_);
+			publish(i, nullptr, new Graph(*tree));
+		}
+
+		/**
+		 * parse a script file again and replace its tree if anything changed, the file name is the tree id
+		 * dialogs are compared by id, the new version is swapped in at once while sessions keep running:
+		 * a session finishes its current step on the old version and continues at the same dialog id in the new one
+		 * tree links are resolved to tree indices, which a reload keeps, so links into the reloaded tree need no update
+		 * the old version is kept if the file has errors, one reload (or compile) at a time
+		 * @param diagnostics receive the errors and warnings of the file
+		 * @param _changes receive the changed dialogs, default = nullptr
+		 * @return whether the tree was replaced
+		 */
+		bool reloadScriptFile(const std::string &fname, Diagnostics &diagnostics, Changes *_changes = nullptr)
+		{
+			size_t i = find(fname);
+			if (i == trees.npos)
+			{
+				diagnostics.report<1>(0, "cannot find tree with id: ", fname);
+				return false;
+			}
+
+			Slot &slot = graphs[i];
+			std::lock_guard<std::mutex> loading(slot.loading);
+			std::shared_ptr<const Graph> old;
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				old = slot.graph;
+			}
+			if (!old)
+				return false; // a lazy tree that is not loaded is read again on its next use
+
+			Graph *graph = nullptr;
+			MappedFile::Stamp stamp;
+			Tree *tree = load(fname, graph, stamp, diagnostics);
+			if (stamp.size >= 0)
+				slot.stamp = stamp; // a failed version is not reported again until the file changes
+			if (tree == nullptr)
+				return false;
+
+			Changes changes;
+			if (!diff(*old, *graph, changes))
+			{
+				delete graph;
+				delete tree;
+				return false;
+			}
+
+			if (slot.lazy)
+			{
+				delete tree;
+				tree = nullptr;
+			}
+			else
+			{
+				tree->incrementScore((trees.begin() + i)->second->score());
+				tree->intern(symbols_);
+			}
+			publish(i, tree, graph);
+			if (_changes != nullptr)
+				*_changes = std::move(changes);
+			return true;
+		}
+
+		/**
+		 * reload every script file modified since it was read, to be polled by the application
+		 * trees loaded from a compiled story are not watched
+		 * @param diagnostics receive the errors and warnings of every reloaded file, same index as the trees
+		 * @return number of trees replaced
+		 */
+		size_t reloadChangedFiles(std::vector<Diagnostics> &diagnostics)
+		{
+			diagnostics.assign(graphs.size(), Diagnostics());
+			size_t reloaded = 0;
+			for (size_t i = 0; i < graphs.size(); i++)
+			{
+				MappedFile::Stamp known;
+				{
+					std::lock_guard<std::mutex> loading(graphs[i].loading);
+					known = graphs[i].stamp;
+				}
+				if (known.size < 0)
+					continue;
+				const std::string &fname = (trees.begin() + i)->first;
+				MappedFile::Stamp stamp = MappedFile::stamp(fname);
+				if (stamp.size >= 0 && stamp != known)
+					reloaded += reloadScriptFile(fname, diagnostics[i]);
+			}
+			return reloaded;
+		}
+
+		/**
+		 * get the symbol table of all ids and links
+		 */
+		inline Symbols &symbols() { return symbols_; }
+
+		/**
+		 * get all parsed trees
+		 */
+		inline const FlatMap<std::string, Tree *> &tree() const { return trees; }
+
+		/**
+		 * get the compiled graph of a tree, valid until the tree is reloaded
+		 * @return the graph, nullptr if the tree is not loaded
+		 */
+		const Graph *graph(std::string_view _id) const
+		{
+			size_t i = find(_id);
+			return i == trees.npos ? nullptr : graphs[i].current.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * get the memory used by a tree, its parsed nodes and its current graph, a lazy tree is not loaded
+		 * trees loaded from a compiled story or lazily have no nodes, their counts are taken from the graph
+		 * @param _tree tree index
+		 */
+		Footprint footprint(uint32_t _tree) const
+		{
+			std::shared_lock<std::shared_mutex> lock(swap_);
+			Footprint f = (trees.begin() + _tree)->second->footprint();
+			if (const Graph *graph = graphs[_tree].graph.get())
+			{
+				if (f.dialogs == 0)
+				{
+					f.dialogs = graph->dialogCount();
+					f.decisions = graph->decisionCount();
+				}
+				f.graphBytes = graph->image().size();
+				f.graphTextBytes = graph->textSize();
+				f.shared = graph->borrowed();
+			}
+			if (const TextIndex *index = graphs[_tree].index.get())
+				f.indexBytes = index->bytes();
+			return f;
+		}
+
+		/**
+		 * get number of trees, trees are indexed in loading order
+		 */
+		inline uint32_t treeCount() const { return (uint32_t)graphs.size(); }
+
+		/**
+		 * get the index of a tree
+		 * @return tree index, Graph::npos if the tree is not loaded
+		 */
+		inline uint32_t treeIndex(std::string_view _id) const
+		{
+			size_t i = find(_id);
+			return i == trees.npos ? Graph::npos : (uint32_t)i;
+		}
+
+		/**
+		 * get the compiled graph of a tree by index, valid until the tree is reloaded
+		 */
+		inline const Graph *graph(uint32_t _tree) const { return graphs[_tree].current.load(std::memory_order_acquire); }
+
+		/**
+		 * get the compiled graph the session is in, valid until the session moves
+		 * @return the graph, nullptr if the session is not in any tree
+		 */
+		inline const Graph *graph(const Session &_session) const { return _session.graph_.get(); }
+
+		/**
+		 * @class a dialog or decision found by search() or searchId(), valid until the tree is reloaded like graph()
+		 */
+		struct Hit
+		{
+			uint32_t tree;
+			uint32_t dialog;
+			uint32_t decision; // Graph::npos if the dialog itself matched
+		};
+
+		/**
+		 * find the dialogs and decisions of all loaded trees whose message contains a text, ignoring ascii case
+		 * safe to call while trees are reloaded, a reloaded tree is indexed again, see configure::search_index
+		 * @param _limit largest number of hits
+		 * @return hits in tree order, then in script order
+		 */
+		std::vector<Hit> search(std::string_view _text, size_t _limit = SIZE_MAX) const
+		{
+			std::vector<Hit> hits;
+			auto all = indexes();
+			for (uint32_t t = 0; t < all.size() && hits.size() < _limit; t++)
+				if (all[t].second)
+					for (uint32_t n : all[t].second->match(_text, _limit - hits.size()))
+					{
+						TextIndex::Hit hit = all[t].second->at(n);
+						hits.push_back({t, hit.dialog, hit.decision});
+					}
+			return hits;
+		}
+
+		/**
+		 * find the dialogs and decisions of all loaded trees whose id starts with a prefix
+		 * @param _limit largest number of hits
+		 * @return hits in tree order, then in script order
+		 */
+		std::vector<Hit> searchId(std::string_view _prefix, size_t _limit = SIZE_MAX) const
+		{
+			std::vector<Hit> hits;
+			auto all = indexes();
+			for (uint32_t t = 0; t < all.size() && hits.size() < _limit; t++)
+				if (all[t].second)
+					for (uint32_t n : all[t].second->prefix(_prefix, _limit - hits.size()))
+					{
+						TextIndex::Hit hit = all[t].second->at(n);
+						hits.push_back({t, hit.dialog, hit.decision});
+					}
+			return hits;
+		}
+
+		/**
+		 * start a new session at the first dialog of a tree
+		 * the story is only read by sessions, any number of sessions can run concurrently on different threads
+		 * @return the session, done() if the tree is not loaded
+		 */
+		Session start(std::string_view _tree) const
+		{
+			Session session;
+			session.id_ = sessions_.fetch_add(1, std::memory_order_relaxed) + 1;
+			session.scores_.reserve(trees.size());
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				for (auto const &t : trees)
+					session.scores_.push_back(t.second->score());
+			}
+
+			if (!enter(session, treeIndex(_tree)))
+				console::log<2>("cannot find tree with id: ", _tree);
+			return session;
+		}
+
+		/**
+		 * whether a decision can be chosen in a session, a lazy tree that is not loaded is loaded, false if it cannot be
+		 * @param _tree tree index
+		 * @param _decision decision index in the graph of the tree, graph(_session) for the current tree
+		 */
+		bool enabled(const Session &_session, uint32_t _tree, uint32_t _decision) const
+		{
+			if (_tree == _session.tree_ && _session.graph_)
+				return enabled(_session, _tree, _decision, *_session.graph_);
+			// another tree may be lazy and unloaded (or unloaded while in use here), its graph is kept alive for the call
+			std::shared_ptr<const Graph> graph = _tree < graphs.size() ? pin(_tree) : nullptr;
+			return graph && enabled(_session, _tree, _decision, *graph);
+		}
+
+		/**
+		 * enable or disable a decision for a session only
+		 * @param _tree tree index
+		 * @param _decision decision index in the graph of the tree, graph(_session) for the current tree
+		 */
+		void enable(Session &_session, uint32_t _tree, uint32_t _decision, bool _enabled) const
+		{
+			std::shared_ptr<const Graph> graph = _tree == _session.tree_ && _session.graph_ ? _session.graph_ : _tree < graphs.size() ? pin(_tree) : nullptr;
+			if (!graph || enabled(_session, _tree, _decision, *graph) == _enabled)
+				return;
+			retarget(_session, _tree, graph);
+			_session.toggle(_tree, _decision, graph);
+		}
+
+		/**
+		 * render the current dialog of a session and its decisions, then flush the output
+		 * decisions are indented with configure::output_indent, disabled ones are hidden unless configure::display_disabled_decisions
+		 */
+		void render(const Session &_session, Output &_output) const
+		{
+			if (_session.done())
+				return;
+			compose(_session, [&](std::string_view _data) { _output.write(_data); });
+			_output.flush();
+		}
+
+		/**
+		 * follow the link of the current dialog, used when the dialog has no decision
+		 * @return whether the session can continue
+		 */
+		bool next(Session &_session) const
+		{
+			if (_session.done())
+				return false;
+			uint64_t begin = Metrics::now();
+			if (Recorder *recorder = recorder_.load(std::memory_order_relaxed))
+				recorder->add({_session.id_, _session.tree_, _session.dialog_, Record::next, Recorder::now()});
+			follow(_session, _session.graph_->dialogLink(_session.dialog_));
+			refresh(_session);
+#if TEXTENGINE_METRICS
+			Metrics::step(_session.latency_, begin);
+#endif
+			(void)begin;
+			return !_session.done();
+		}
+
+		/**
+		 * choose a decision of the current dialog and follow its link
+		 * the decision score is added to the session score of the current tree
+		 * the decision is taken in the graph the dialog was rendered from, even if the tree was reloaded since
+		 * @param _decision index of the decision within the dialog, starting from 0
+		 * @return whether the decision was chosen, the session stays in place if not
+		 */
+		bool choose(Session &_session, uint32_t _decision) const
+		{
+			if (_session.done())
+				return false;
+
+			uint64_t begin = Metrics::now();
+			const Graph *graph = _session.graph_.get();
+			uint32_t decision = graph->firstDecision(_session.dialog_) + _decision;
+			if (decision >= graph->lastDecision(_session.dialog_) || !enabled(_session, _session.tree_, decision))
+			{
+				console::log<2>("decision cannot be chosen: ", _decision);
+				return false;
+			}
+
+			if (Recorder *recorder = recorder_.load(std::memory_order_relaxed))
+				recorder->add({_session.id_, _session.tree_, _session.dialog_, _decision, Recorder::now()});
+			_session.incrementScore(_session.tree_, graph->decisionScore(decision));
+			follow(_session, graph->decisionLink(decision));
+			refresh(_session);
+#if TEXTENGINE_METRICS
+			Metrics::step(_session.latency_, begin);
+#endif
+			(void)begin;
+			return true;
+		}
+
+		/**
+		 * @class result of a step made by step() or stepAsync()
+		 */
+		struct Step
+		{
+			static constexpr uint32_t next = UINT32_MAX; // decision of a step that follows the dialog link, like next()
+
+			bool moved = false;			   // whether the session moved, false if the decision cannot be chosen or the game had ended
+			std::string output;			   // the new dialog rendered like render(), empty once the game has ended
+			std::vector<uint32_t> loading; // lazy trees linked from the new dialog, queued to load in the background
+		};
+
+		/**
+		 * runs a task later, on another thread (a thread pool, an event loop...), must not run it inline
+		 */
+		using Executor = std::function<void(std::function<void()>)>;
+
+		/**
+		 * whether a step can be made at once, it cannot if it enters a lazy tree that is not loaded
+		 * @param _decision index of the decision within the dialog, or Step::next
+		 */
+		bool ready(const Session &_session, uint32_t _decision) const
+		{
+			return _session.done() || unloaded(*_session.graph_, stepLink(_session, _decision)) == Graph::npos;
+		}
+
+		/**
+		 * load a lazy tree in the background, so no session has to wait for it
+		 * @return whether a load was queued, false if the tree is loaded or already being loaded
+		 */
+		bool prefetch(uint32_t _tree, const Executor &_executor) const
+		{
+			Slot &slot = graphs[_tree];
+			if (!slot.lazy || slot.current.load(std::memory_order_acquire) != nullptr || slot.prefetching.exchange(true))
+				return false;
+			_executor([this, _tree]() {
+				pin(_tree);
+				graphs[_tree].prefetching.store(false);
+			});
+			return true;
+		}
+
+		/**
+		 * choose a decision (or follow the dialog link if Step::next) and render the new dialog
+		 * blocks on loading a lazy tree the step enters if it is not loaded, see ready()
+		 * the lazy trees the new dialog links to are prefetched with _executor, so the next step does not block
+		 * @param _decision index of the decision within the dialog, or Step::next
+		 */
+		Step step(Session &_session, uint32_t _decision, const Executor &_executor) const
+		{
+			Step result;
+			if (_decision == Step::next)
+			{
+				result.moved = !_session.done();
+				next(_session);
+			}
+			else
+				result.moved = choose(_session, _decision);
+			if (_session.done())
+				return result;
+
+			compose(_session, [&](std::string_view _data) { result.output.append(_data); });
+			const Graph &graph = *_session.graph_;
+			for (uint32_t d = graph.firstDecision(_session.dialog_); d <= graph.lastDecision(_session.dialog_); d++)
+			{
+				// the decisions, then the dialog link (followed when there is no decision)
+				Graph::Link link = d < graph.lastDecision(_session.dialog_) ? graph.decisionLink(d) : graph.dialogLink(_session.dialog_);
+				uint32_t tree = unloaded(graph, link);
+				if (tree != Graph::npos && prefetch(tree, _executor))
+					result.loading.push_back(tree);
+			}
+			return result;
+		}
+
+		/**
+		 * make a step without blocking the calling thread (an i/o thread)
+		 * a step that is ready() is made at once and _done is called before returning, otherwise the step is made on _executor
+		 * the session must not be used until _done is called
+		 * @param _done called with the result, on the calling thread or on a thread of _executor
+		 */
+		void stepAsync(Session &_session, uint32_t _decision, std::function<void(Step)> _done, const Executor &_executor) const
+		{
+			if (ready(_session, _decision))
+				return _done(step(_session, _decision, _executor));
+			Executor executor = _executor;
+			_executor([this, &_session, _decision, done = std::move(_done), executor = std::move(executor)]() {
+				done(step(_session, _decision, executor));
+			});
+		}
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+		/**
+		 * @class awaitable step for c++20 coroutines, co_await engine.stepAwait(...) resumes with the Step
+		 * a step that is ready() does not suspend, otherwise the coroutine is resumed on a thread of the executor
+		 */
+		struct StepAwaiter
+		{
+			const Engine &engine;
+			Session &session;
+			uint32_t decision;
+			Executor executor;
+			Step result;
+
+			bool await_ready()
+			{
+				if (!engine.ready(session, decision))
+					return false;
+				result = engine.step(session, decision, executor);
+				return true;
+			}
+
+			void await_suspend(std::coroutine_handle<> _handle)
+			{
+				engine.stepAsync(session, decision, [this, _handle](Step _step) {
+					result = std::move(_step);
+					_handle.resume();
+				}, executor);
+			}
+
+			Step await_resume() { return std::move(result); }
+		};
+
+		/**
+		 * make a step from a coroutine, see StepAwaiter
+		 */
+		StepAwaiter stepAwait(Session &_session, uint32_t _decision, Executor _executor) const { return StepAwaiter{*this, _session, _decision, std::move(_executor), {}}; }
+#endif
+
+		/**
+		 * append a compact binary snapshot of a session, cheap enough to checkpoint after every step
+		 * only what differs from a new session is written: the current dialog, changed scores and toggled decisions
+		 * trees, dialogs and decisions are saved by id (with their index as a hint), so a snapshot can be restored
+		 * by another engine with the same story, or after the trees were reloaded
+		 * @param _out receive the snapshot, appended
+		 */
+		void save(const Session &_session, std::string &_out) const
+		{
+			_out.append(snapshotMagic, sizeof(snapshotMagic));
+			_out.push_back(char(snapshotVersion));
+
+			// current dialog, dialog index + 1 so 0 is a finished session
+			putId(_out, _session.tree_ < trees.size() ? std::string_view((trees.begin() + _session.tree_)->first) : std::string_view());
+			putVarint(_out, _session.done() ? 0 : uint64_t(_session.dialog_) + 1);
+			if (!_session.done())
+				putId(_out, _session.graph_->dialogId(_session.dialog_));
+
+			// scores that differ from the initial score of their tree
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				size_t count = std::min(_session.scores_.size(), trees.size());
+				auto delta = [&](size_t t) { return int64_t(_session.scores_[t]) - (trees.begin() + t)->second->score(); };
+				uint32_t changed = 0;
+				for (size_t t = 0; t < count; t++)
+					changed += delta(t) != 0;
+				putVarint(_out, changed);
+				for (size_t t = 0; t < count; t++)
+					if (int64_t d = delta(t))
+					{
+						putId(_out, (trees.begin() + t)->first);
+						putVarint(_out, uint64_t(d) << 1 ^ uint64_t(d >> 63)); // zigzag, small negative deltas stay short
+					}
+			}
+
+			// decisions whose enabled status differs from the story, toggled back and forth ones are not
+			uint32_t toggledTrees = 0;
+			for (auto const &toggles : _session.toggled_)
+				toggledTrees += toggles.count != 0;
+			putVarint(_out, toggledTrees);
+			for (size_t t = 0; t < _session.toggled_.size(); t++)
+			{
+				auto const &toggles = _session.toggled_[t];
+				if (toggles.count == 0)
+					continue;
+				putId(_out, (trees.begin() + t)->first);
+				putVarint(_out, toggles.count);
+				for (size_t w = 0; w < toggles.bits.size(); w++)
+					for (uint64_t word = toggles.bits[w]; word != 0; word &= word - 1)
+					{
+						uint32_t d = uint32_t(w * 64 + __builtin_ctzll(word));
+						putVarint(_out, d);
+						putId(_out, toggles.graph->dialogId(dialogOf(*toggles.graph, d)));
+						putId(_out, toggles.graph->decisionId(d));
+					}
+			}
+		}
+
+		/**
+		 * get a compact binary snapshot of a session, see save(const Session &, std::string &)
+		 */
+		std::string save(const Session &_session) const
+		{
+			std::string out;
+			save(_session, out);
+			return out;
+		}
+
+		/**
+		 * restore a session from a snapshot written by save()
+		 * trees that are no longer in the story and decisions that were removed are skipped, a removed dialog restarts its tree
+		 * @exception invalid session snapshot
+		 */
+		Session restore(std::string_view _snapshot) const
+		{
+			SnapshotReader in{_snapshot.data(), _snapshot.data() + _snapshot.size()};
+			if (_snapshot.size() < sizeof(snapshotMagic) + 1 || std::memcmp(in.it, snapshotMagic, sizeof(snapshotMagic)) != 0)
+				console::log<1>("invalid session snapshot");
+			in.it += sizeof(snapshotMagic);
+			if ((uint8_t)*in.it++ != snapshotVersion)
+				console::log<1>("unsupported session snapshot version: ", int((uint8_t)in.it[-1]));
+
+			Session session;
+			session.id_ = sessions_.fetch_add(1, std::memory_order_relaxed) + 1;
+			session.scores_.reserve(trees.size());
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				for (auto const &t : trees)
+					session.scores_.push_back(t.second->score());
+			}
+
+			// current dialog
+			std::string_view tree = in.id();
+			uint64_t dialog = in.varint();
+			std::string_view dialogId = dialog != 0 ? in.id() : std::string_view();
+			if (!tree.empty() && enter(session, treeIndex(tree)) && dialog != 0)
+			{
+				uint32_t found = findDialog(*session.graph_, dialog - 1, dialogId);
+				if (found != Graph::npos)
+					session.dialog_ = found;
+				else
+					console::log<2>("cannot find dialog with id: ", dialogId, ", the session restarts tree: ", tree);
+			}
+			else if (!tree.empty() && !session.done())
+			{
+				session.dialog_ = Graph::npos;
+				session.graph_.reset();
+			}
+
+			// scores
+			for (uint64_t n = in.varint(); n > 0; n--)
+			{
+				uint32_t t = treeIndex(in.id());
+				uint64_t zigzag = in.varint();
+				if (t != Graph::npos)
+					session.scores_[t] += int(int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1));
+			}
+
+			// toggled decisions
+			for (uint64_t n = in.varint(); n > 0; n--)
+			{
+				uint32_t t = treeIndex(in.id());
+				std::shared_ptr<const Graph> graph = t == Graph::npos ? nullptr : t == session.tree_ && session.graph_ ? session.graph_ : pin(t);
+				for (uint64_t decisions = in.varint(); decisions > 0; decisions--)
+				{
+					uint64_t hint = in.varint();
+					std::string_view dialog = in.id(), decision = in.id();
+					uint32_t d = graph ? findDecision(*graph, hint, dialog, decision) : Graph::npos;
+					if (d != Graph::npos && !session.toggled(t, d))
+						session.toggle(t, d, graph);
+				}
+			}
+			if (in.it != in.end)
+				console::log<1>("invalid session snapshot");
+			return session;
+		}
+
+		/**
+		 * play many walks from the first dialog of a tree, in batch on all cores and without output
+		 * every walk has its own session (started like start()), so scores are kept per walk
+		 * walks are handed out in small chunks to the next free thread, so long and short walks balance out
+		 * @param _policy chooses among the enabled decisions, see RandomPolicy, must be safe to call concurrently
+		 * @param _max_steps steps after which a walk is stopped, default = 10000 (stories can loop)
+		 * @param _seed seed of the random states of the walks, default = 0, a run is reproducible for a given seed
+		 * @param _threads number of threads, default = 0 (hardware concurrency)
+		 * @param _visit called with every walk once it ended, concurrently, default = none
+		 */
+		template <typename Policy>
+		RunStats run(std::string_view _tree, size_t _walks, const Policy &_policy, uint32_t _max_steps = 10000, uint64_t _seed = 0, unsigned _threads = 0,
+					 const std::function<void(const Session &, const Walk &)> &_visit = nullptr) const
+		{
+			auto begin = std::chrono::steady_clock::now();
+			Session origin = start(_tree);
+
+			const size_t chunk = 64;
+			std::mutex mutex;
+			RunStats stats;
+			Workers::run((_walks + chunk - 1) / chunk, [&](size_t c) {
+				RunStats local;
+				std::vector<uint32_t> options;
+				for (size_t i = c * chunk; i < _walks && i < (c + 1) * chunk; i++)
+				{
+					Session session = origin;
+					if (recorder_.load(std::memory_order_relaxed))
+						session.id_ = sessions_.fetch_add(1, std::memory_order_relaxed) + 1; // walks are recorded apart
+					Walk walk{i, 0, 0, Walk::seed(_seed, i)};
+					play(session, walk, _policy, _max_steps, options);
+					local.add(session, walk.step);
+					if (_visit)
+						_visit(session, walk);
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				stats.add(local);
+			}, _threads);
+
+			stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			return stats;
+		}
+
+		/**
+		 * play every possible walk from the first dialog of a tree, on all cores and without output
+		 * a walk ends at an end of the game, at a dialog without enabled decision, or after _max_steps steps so that looping stories stay finite
+		 * the number of walks grows exponentially with the number of steps, keep _max_steps small
+		 * every thread explores its own stack of branches depth first, an idle thread steals the oldest half of the biggest stack
+		 * @param _threads number of threads, default = 0 (hardware concurrency)
+		 * @param _visit called with every walk once it ended (only Walk::step is set), concurrently, default = none
+		 */
+		RunStats explore(std::string_view _tree, uint32_t _max_steps, unsigned _threads = 0, const std::function<void(const Session &, const Walk &)> &_visit = nullptr) const
+		{
+			auto begin = std::chrono::steady_clock::now();
+			struct Branch
+			{
+				Session session;
+				uint32_t step;
+			};
+
+			// push the sessions after every possible step of a branch
+			// @return false if the branch is a finished walk
+			auto expand = [&](Branch &b, std::vector<uint32_t> &options, auto &&push) {
+				if (b.session.done() || b.step >= _max_steps)
+					return false;
+				if (!this->options(b.session, options))
+				{
+					this->next(b.session);
+					b.step++;
+					push(std::move(b));
+					return true;
+				}
+				if (options.empty())
+					return false;
+				uint32_t step = b.step + 1;
+				for (size_t k = 0; k < options.size(); k++)
+				{
+					Branch c = k + 1 < options.size() ? b : std::move(b); // the last step reuses the branch
+					if (k + 1 < options.size() && recorder_.load(std::memory_order_relaxed))
+						c.session.id_ = sessions_.fetch_add(1, std::memory_order_relaxed) + 1; // forks are recorded apart
+					this->choose(c.session, options[k]);
+					c.step = step;
+					push(std::move(c));
+				}
+				return true;
+			};
+			auto leaf = [&](const Branch &b, RunStats &stats) {
+				stats.add(b.session, b.step);
+				if (_visit)
+					_visit(b.session, Walk{0, b.step, 0, 0});
+			};
+
+			// the oldest branches of a stack are the closest to the root, so a steal takes the largest subtrees
+			struct Stack
+			{
+				std::mutex mutex;
+				std::deque<Branch> branches;
+			};
+			unsigned threads = _threads == 0 ? Workers::concurrency() : _threads;
+			std::vector<Stack> stacks(threads);
+			std::atomic<size_t> pending{1}; // branches pushed and not yet expanded, counted before they are pushed
+			std::atomic<bool> failed{false};
+			stacks[0].branches.push_back({start(_tree), 0});
+
+			// move the oldest half of the biggest other stack to an empty stack
+			auto steal = [&](size_t _thief) {
+				size_t victim = _thief, most = 0;
+				for (size_t i = 0; i < stacks.size(); i++)
+				{
+					std::lock_guard<std::mutex> lock(stacks[i].mutex);
+					if (i != _thief && stacks[i].branches.size() > most)
+						victim = i, most = stacks[i].branches.size();
+				}
+				if (victim == _thief)
+					return false;
+
+				std::vector<Branch> taken;
+				{
+					std::lock_guard<std::mutex> lock(stacks[victim].mutex);
+					auto &from = stacks[victim].branches;
+					size_t half = (from.size() + 1) / 2;
+					taken.reserve(half);
+					for (size_t k = 0; k < half; k++)
+					{
+						taken.push_back(std::move(from.front()));
+						from.pop_front();
+					}
+				}
+				std::lock_guard<std::mutex> lock(stacks[_thief].mutex);
+				for (auto &b : taken)
+					stacks[_thief].branches.push_back(std::move(b));
+				return !taken.empty();
+			};
+
+			RunStats stats;
+			std::mutex mutex;
+			Workers::run(threads, [&](size_t t) {
+				RunStats local;
+				std::vector<uint32_t> options;
+				Stack &own = stacks[t];
+				auto push = [&](Branch &&c) {
+					pending.fetch_add(1, std::memory_order_relaxed);
+					std::lock_guard<std::mutex> lock(own.mutex);
+					own.branches.push_back(std::move(c));
+				};
+				try
+				{
+					while (pending.load(std::memory_order_acquire) > 0 && !failed.load(std::memory_order_relaxed))
+					{
+						std::unique_lock<std::mutex> lock(own.mutex);
+						if (own.branches.empty())
+						{
+							lock.unlock();
+							if (!steal(t))
+								std::this_thread::yield();
+							continue;
+						}
+						Branch b = std::move(own.branches.back());
+						own.branches.pop_back();
+						lock.unlock();
+						if (!expand(b, options, push))
+							leaf(b, local);
+						pending.fetch_sub(1, std::memory_order_release);
+					}
+				}
+				catch (...)
+				{
+					failed.store(true, std::memory_order_relaxed); // the other threads would wait forever for the branches of this one
+					throw;
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				stats.add(local);
+			}, _threads);
+
+			stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			return stats;
+		}
+
+		/**
+		 * record the steps (next and choose) of all sessions, including the walks of run and explore
+		 * the recorder must outlive the steps, drain it from any thread, see Recorder
+		 * @param _recorder receives the steps, nullptr = stop recording
+		 */
+		inline void record(Recorder *_recorder) { recorder_.store(_recorder, std::memory_order_relaxed); }
+
+		/**
+		 * append recorded steps to a replay log, blocks can be appended to the same log one after the other
+		 * a block starts with the ids of the trees, then every step as varints with the time as a delta (steps drained are sorted)
+		 * dialogs are saved by index, a log replays against the story it was recorded from
+		 * @param _out receive the block, appended
+		 */
+		void saveLog(const std::vector<Record> &_records, std::string &_out) const
+		{
+			_out.append(logMagic, sizeof(logMagic));
+			_out.push_back(char(logVersion));
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				putVarint(_out, trees.size());
+				for (auto const &t : trees)
+					putId(_out, t.first);
+			}
+
+			putVarint(_out, _records.size());
+			uint64_t time = 0;
+			for (auto const &r : _records)
+			{
+				int64_t delta = int64_t(r.time - time);
+				time = r.time;
+				putVarint(_out, r.session);
+				putVarint(_out, uint64_t(r.tree) + 1);
+				putVarint(_out, r.dialog);
+				putVarint(_out, uint32_t(r.decision + 1)); // Record::next is 0
+				putVarint(_out, uint64_t(delta) << 1 ^ uint64_t(delta >> 63));
+			}
+		}
+
+		/**
+		 * read a replay log written by saveLog(), the steps of all blocks sorted by time
+		 * trees are found by id, the steps of trees that are no longer in the story get Graph::npos as tree
+		 * @exception invalid replay log
+		 */
+		std::vector<Record> loadLog(std::string_view _log) const
+		{
+			std::vector<Record> records;
+			SnapshotReader in{_log.data(), _log.data() + _log.size(), "invalid replay log"};
+			std::vector<uint32_t> indices;
+			while (in.it != in.end)
+			{
+				if (size_t(in.end - in.it) < sizeof(logMagic) + 1 || std::memcmp(in.it, logMagic, sizeof(logMagic)) != 0)
+					console::log<1>("invalid replay log");
+				in.it += sizeof(logMagic);
+				if ((uint8_t)*in.it++ != logVersion)
+					console::log<1>("unsupported replay log version: ", int((uint8_t)in.it[-1]));
+
+				indices.clear();
+				for (uint64_t n = in.varint(); n > 0; n--)
+				{
+					std::string_view id = in.id();
+					indices.push_back((uint32_t)treeIndex(id));
+				}
+
+				uint64_t time = 0;
+				for (uint64_t n = in.varint(); n > 0; n--)
+				{
+					Record r;
+					r.session = in.varint();
+					uint64_t tree = in.varint(), dialog = in.varint(), decision = in.varint(), delta = in.varint();
+					if (tree > indices.size() || dialog > UINT32_MAX || decision > UINT32_MAX)
+						console::log<1>("invalid replay log");
+					r.tree = tree == 0 ? Graph::npos : indices[tree - 1];
+					r.dialog = (uint32_t)dialog;
+					r.decision = (uint32_t)decision - 1;
+					time += uint64_t(int64_t(delta >> 1) ^ -int64_t(delta & 1));
+					r.time = time;
+					records.push_back(r);
+				}
+			}
+			// blocks appended by several engines overlap in time
+			auto earlier = [](const Record &a, const Record &b) { return a.time < b.time; };
+			if (!std::is_sorted(records.begin(), records.end(), earlier))
+				std::stable_sort(records.begin(), records.end(), earlier);
+			return records;
+		}
+
+		/**
+		 * @class totals of a replay, see replay()
+		 */
+		struct Playback
+		{
+			uint64_t sessions = 0; // sessions replayed
+			uint64_t steps = 0;	   // steps made
+			uint64_t missed = 0;   // steps that could not be made, the dialog or decision is no longer in the story
+			double lag = 0;		   // longest delay of a step behind its schedule, in seconds, 0 when not paced
+			double seconds = 0;	   // wall clock time of the replay
+
+			/**
+			 * get the number of steps per second
+			 */
+			inline double stepsPerSecond() const { return seconds > 0 ? steps / seconds : 0; }
+		};
+
+		/**
+		 * play recorded steps again through the engine, on all cores and without output
+		 * sessions are split among the threads, each thread makes the steps of its sessions in time order
+		 * a session is moved to the dialog of every step before it is made, so a log can start in the middle of a session
+		 * the replayed sessions keep their recorded ids, a recording engine logs the same steps again
+		 * @param _records steps sorted by time, from Recorder::drain() or loadLog()
+		 * @param _speed steps are made at their recorded times divided by _speed (2 = twice as fast), default = 0 (as fast as possible)
+		 * @param _threads number of threads, default = 0 (hardware concurrency)
+		 */
+		Playback replay(const std::vector<Record> &_records, double _speed = 0, unsigned _threads = 0) const
+		{
+			auto begin = std::chrono::steady_clock::now();
+			unsigned parts = _threads == 0 ? Workers::concurrency() : _threads;
+			std::vector<std::vector<uint32_t>> steps(parts); // records of every thread
+			for (size_t i = 0; i < _records.size(); i++)
+				steps[_records[i].session % parts].push_back((uint32_t)i);
+
+			Session blank;
+			blank.scores_.reserve(trees.size());
+			{
+				std::shared_lock<std::shared_mutex> lock(swap_);
+				for (auto const &t : trees)
+					blank.scores_.push_back(t.second->score());
+			}
+			uint64_t origin = _records.empty() ? 0 : _records.front().time;
+
+			std::mutex mutex;
+			Playback stats;
+			Workers::run(parts, [&](size_t p) {
+				Playback local;
+				FlatMap<uint64_t, uint32_t> ids;
+				std::vector<Session> sessions;
+				for (uint32_t i : steps[p])
+				{
+					const Record &r = _records[i];
+					if (_speed > 0)
+					{
+						auto due = begin + std::chrono::nanoseconds(uint64_t(double(r.time - origin) / _speed));
+						auto now = std::chrono::steady_clock::now();
+						if (now < due)
+							std::this_thread::sleep_until(due);
+						else
+							local.lag = std::max(local.lag, std::chrono::duration<double>(now - due).count());
+					}
+
+					auto added = ids.emplace(r.session, (uint32_t)sessions.size());
+					if (added.second)
+					{
+						sessions.push_back(blank);
+						sessions.back().id_ = r.session;
+						local.sessions++;
+					}
+					Session &session = sessions[added.first->second];
+
+					bool moved = (!session.done() && session.tree_ == r.tree && session.dialog_ == r.dialog) || place(session, r.tree, r.dialog);
+					if (moved && r.decision == Record::next)
+						next(session);
+					else if (moved)
+						moved = choose(session, r.decision);
+					local.steps += moved;
+					local.missed += !moved;
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				stats.sessions += local.sessions;
+				stats.steps += local.steps;
+				stats.missed += local.missed;
+				stats.lag = std::max(stats.lag, local.lag);
+			}, parts);
+
+			stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			return stats;
+		}
+
+		~Engine()
+		{
+			graphs.clear();
+			for (auto t : trees)
+				delete t.second;
+			for (auto s : stories)
+				delete s;
+		}
+	};
+} // namespace textengine
+
+// static initialization
+textengine::StreamSink textengine::console::standard_(std::cout);
+textengine::Output textengine::console::output_(&textengine::console::standard_);
+std::mutex textengine::console::mutex_;
+int textengine::console::level_ = 4;
+std::atomic<uint64_t> textengine::Recorder::ids_{0};
+std::atomic<uint64_t> textengine::Metrics::counters_[textengine::Metrics::counterCount];
+std::atomic<uint64_t> textengine::Metrics::nanos_[textengine::Metrics::phaseCount];
+std::atomic<uint64_t> textengine::Metrics::calls_[textengine::Metrics::phaseCount];
+std::atomic<uint64_t> textengine::Metrics::steps_[textengine::Metrics::Histogram::buckets];
+const int textengine::Parser::uniqueSeed = 3010299; // log 2, to create an unique id / link to dialog / decision
\ No newline at end of file
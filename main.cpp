@@ -1,24 +1,156 @@
-#include "engine.hpp"
-
-int main(int args, char *argv[])
-{
-	textengine::Engine *engine = new textengine::Engine();
-	for (int i = 1; i < args; i++)
-		engine->parseScriptFile(std::string(argv[i]));
-	auto const &trees = engine->tree();
-	delete engine;
-
-	for (auto const &t : trees)
-	{
-		textengine::console::out("tree");
-		auto dialogs = t.second->allDialogs();
-		for (auto const &d : dialogs)
-		{
-			textengine::console::out(d.second->message());
-			auto decisions = d.second->allDecisions();
-			for (auto de : decisions)
-				textengine::console::out(de.second->message());
-		}
-		textengine::console::out("\n\n\n");
-	}
+#include "engine.hpp"
+
+// usage:
+//   a.out <script>...              parse the scripts and print all trees
+//   a.out -c <story> <script>...   compile the scripts into a story file
+//   a.out -s <story>               load a compiled story file and print all trees
+//   a.out -v <script>...           check the scripts and their links, print all problems
+//   a.out -r <walks> <script>...   play random walks from the first script and print the statistics
+//   a.out -m <script>...           print the memory used by every tree, one json object per line
+//   a.out -f <text> <script>...    print the dialogs and decisions whose message contains the text
+//   a.out -o <script>...           print the endings, walks and score range of every tree
+//   a.out -l <log> <walks> <script>...  play random walks from the first script and append their steps to a replay log
+//   a.out -p <log> <speed> <script>...  replay a log at speed times its recorded pace (0 = as fast as possible) and print the statistics
+int main(int args, char *argv[])
+{
+	textengine::Engine *engine = new textengine::Engine();
+	std::string mode = args > 2 ? argv[1] : "";
+
+	if (mode == "-c")
+	{
+		engine->parseScriptFiles(std::vector<std::string>(argv + 3, argv + args));
+		engine->writeStoryFile(argv[2]);
+		delete engine;
+		return 0;
+	}
+	else if (mode == "-v")
+	{
+		std::vector<std::string> fnames(argv + 2, argv + args);
+		std::vector<textengine::Diagnostics> diagnostics;
+		bool ok = engine->parseScriptFiles(fnames, diagnostics);
+		for (size_t i = 0; i < fnames.size(); i++)
+			for (auto const &e : diagnostics[i].entries())
+				textengine::console::out(fnames[i] + (e.level == 1 ? ": error: " : ": warning: ") + e.text());
+
+		textengine::Engine::Analysis analysis = engine->analyze();
+		auto where = [&](textengine::Engine::Analysis::Node n) {
+			const textengine::Graph *graph = engine->graph(n.tree);
+			return std::string(graph->id()) + ": dialog " + std::string(graph->dialogId(n.dialog));
+		};
+		for (auto const &d : analysis.dangling)
+			textengine::console::out(where(d.from) + ": link to unknown " + (d.type == textengine::Graph::LinkType::tree ? "tree: " : "dialog: ") + d.target);
+		for (auto const &n : analysis.unreachable)
+			textengine::console::out(where(n) + ": unreachable");
+		for (auto const &c : analysis.cycles)
+			if (c.closed)
+				textengine::console::out(where(c.nodes.front()) + ": in a cycle that cannot be left, " + std::to_string(c.nodes.size()) + " dialogs");
+		textengine::console::flush();
+		delete engine;
+		return ok && analysis.dangling.empty() ? 0 : 1;
+	}
+	else if (mode == "-r" && args > 3)
+	{
+		std::vector<std::string> fnames(argv + 3, argv + args);
+		engine->parseScriptFiles(fnames);
+		textengine::RunStats stats = engine->run(fnames.front(), std::stoull(argv[2]), textengine::RandomPolicy());
+		textengine::console::out("walks: " + std::to_string(stats.walks) + ", finished: " + std::to_string(stats.finished) +
+								 ", steps: " + std::to_string(stats.steps) + ", steps/s: " + std::to_string((uint64_t)stats.stepsPerSecond()) +
+								 ", score: " + std::to_string(stats.minScore) + " to " + std::to_string(stats.maxScore));
+		if constexpr (textengine::Metrics::enabled)
+			textengine::console::out(textengine::Engine::metrics().json());
+		textengine::console::flush();
+		delete engine;
+		return 0;
+	}
+	else if (mode == "-m")
+	{
+		engine->parseScriptFiles(std::vector<std::string>(argv + 2, argv + args));
+		for (uint32_t t = 0; t < engine->treeCount(); t++)
+			textengine::console::out(std::string((engine->tree().begin() + t)->first) + ": " + engine->footprint(t).json());
+		textengine::console::flush();
+		delete engine;
+		return 0;
+	}
+	else if (mode == "-f" && args > 3)
+	{
+		engine->parseScriptFiles(std::vector<std::string>(argv + 3, argv + args));
+		for (auto const &hit : engine->search(argv[2]))
+		{
+			const textengine::Graph *graph = engine->graph(hit.tree);
+			std::string where = std::string(graph->id()) + ": dialog " + std::string(graph->dialogId(hit.dialog));
+			if (hit.decision != textengine::Graph::npos)
+				where += ": decision " + std::string(graph->decisionId(hit.decision));
+			textengine::console::out(where);
+		}
+		textengine::console::flush();
+		delete engine;
+		return 0;
+	}
+	else if (mode == "-o")
+	{
+		engine->parseScriptFiles(std::vector<std::string>(argv + 2, argv + args));
+		std::vector<textengine::Engine::Outcome> outcomes = engine->outcomes();
+		for (uint32_t t = 0; t < engine->treeCount(); t++)
+		{
+			const textengine::Engine::Outcome &o = outcomes[t];
+			std::string paths = o.paths == textengine::Engine::Outcome::unbounded ? "unbounded" : std::to_string(o.paths);
+			std::string score = (o.unboundedMin ? "unbounded" : std::to_string(o.minScore)) + " to " + (o.unboundedMax ? "unbounded" : std::to_string(o.maxScore));
+			textengine::console::out(std::string((engine->tree().begin() + t)->first) + ": endings: " + std::to_string(o.endings) + ", walks: " + paths +
+									 ", score: " + (o.endings ? score : "none"));
+		}
+		textengine::console::flush();
+		delete engine;
+		return 0;
+	}
+	else if (mode == "-l" && args > 4)
+	{
+		std::vector<std::string> fnames(argv + 4, argv + args);
+		engine->parseScriptFiles(fnames);
+		textengine::Recorder recorder;
+		engine->record(&recorder);
+		engine->run(fnames.front(), std::stoull(argv[3]), textengine::RandomPolicy());
+		engine->record(nullptr);
+		std::vector<textengine::Record> records;
+		recorder.drain(records);
+		std::string log;
+		engine->saveLog(records, log);
+		std::ofstream(argv[2], std::ios::binary | std::ios::app).write(log.data(), log.size());
+		textengine::console::out("steps: " + std::to_string(records.size()) + ", bytes: " + std::to_string(log.size()));
+		textengine::console::flush();
+		delete engine;
+		return 0;
+	}
+	else if (mode == "-p" && args > 4)
+	{
+		engine->parseScriptFiles(std::vector<std::string>(argv + 4, argv + args));
+		textengine::MappedFile file(argv[2]);
+		if (!file.isOpen())
+			textengine::console::log<1>("cannot open file: ", argv[2]);
+		textengine::Engine::Playback stats = engine->replay(engine->loadLog(file.view()), std::stod(argv[3]));
+		textengine::console::out("sessions: " + std::to_string(stats.sessions) + ", steps: " + std::to_string(stats.steps) +
+								 ", missed: " + std::to_string(stats.missed) + ", steps/s: " + std::to_string((uint64_t)stats.stepsPerSecond()) +
+								 ", lag: " + std::to_string(stats.lag) + " s");
+		textengine::console::flush();
+		delete engine;
+		return 0;
+	}
+	else if (mode == "-s")
+		engine->loadStoryFile(argv[2]);
+	else
+		engine->parseScriptFiles(std::vector<std::string>(argv + 1, argv + args));
+
+	for (auto const &t : engine->tree())
+	{
+		textengine::console::out("tree");
+		const textengine::Graph *graph = engine->graph(t.first);
+		for (uint32_t d = 0; d < graph->dialogCount(); d++)
+		{
+			textengine::console::out(graph->dialogMessage(d));
+			for (uint32_t de = graph->firstDecision(d); de < graph->lastDecision(d); de++)
+				textengine::console::out(graph->decisionMessage(de));
+		}
+		textengine::console::out("\n\n\n");
+		textengine::console::flush();
+	}
+	delete engine;
 }
\ No newline at end of file
@@ -0,0 +1,592 @@
+#include "engine.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace textengine;
+
+/**
+ * scripts written to a temporary directory, removed at exit
+ */
+struct Scripts
+{
+	std::string directory;
+	std::vector<std::string> files;
+
+	Scripts()
+	{
+		char path[] = "/tmp/textengine-test-XXXXXX";
+		if (mkdtemp(path) == nullptr)
+			throw exception("cannot create a temporary directory");
+		directory = path;
+	}
+
+	/**
+	 * write a script, the directories of its name are created
+	 * @return the path of the script
+	 */
+	std::string add(const std::string &_name, const std::string &_script)
+	{
+		for (size_t slash = _name.find('/'); slash != std::string::npos; slash = _name.find('/', slash + 1))
+			mkdir((directory + "/" + _name.substr(0, slash)).c_str(), 0700);
+		files.push_back(directory + "/" + _name);
+		std::ofstream(files.back()) << _script;
+		return files.back();
+	}
+
+	~Scripts()
+	{
+		std::string command = "rm -rf " + directory;
+		if (std::system(command.c_str()) != 0)
+			std::cerr << "cannot remove " << directory << "\n";
+	}
+};
+
+static int failures = 0;
+
+/**
+ * report a failed check, the test goes on
+ */
+static void check(bool _ok, const char *_test, const char *_what)
+{
+	if (!_ok)
+	{
+		std::cerr << _test << ": failed: " << _what << "\n";
+		failures++;
+	}
+}
+
+#define CHECK(test, condition) check((condition), test, #condition)
+
+/**
+ * a duplicate tree id adds none of the files
+ */
+static void testParseDuplicate()
+{
+	const char *test = "parse duplicate";
+	Scripts scripts;
+	std::string a = scripts.add("a", "- $[a1] first\n");
+	std::string b = scripts.add("b", "- $[b1] second\n");
+
+	Engine engine;
+	bool thrown = false;
+	try
+	{
+		engine.parseScriptFiles({a, b, a});
+	}
+	catch (const exception &)
+	{
+		thrown = true;
+	}
+	CHECK(test, thrown);
+	CHECK(test, engine.tree().size() == 0);
+
+	engine.parseScriptFile(a);
+	thrown = false;
+	try
+	{
+		engine.parseScriptFiles({b, a});
+	}
+	catch (const exception &)
+	{
+		thrown = true;
+	}
+	CHECK(test, thrown);
+	CHECK(test, engine.tree().size() == 1);
+}
+
+/**
+ * the decisions of a duplicate dialog are dropped with it, only the duplicate id is reported
+ */
+static void testDuplicateDialog()
+{
+	const char *test = "duplicate dialog";
+	Scripts scripts;
+	std::string a = scripts.add("a", "+ $[x] before any dialog $d[a1]\n- $[a1] first $d[a1]\n- $[a1] again $d[a1]\n+ $[a1 x] one $d[a1]\n+ $[a1 y] two $d[a1]\n");
+
+	Engine engine;
+	Diagnostics diagnostics;
+	CHECK(test, !engine.parseScriptFile(a, diagnostics));
+	size_t duplicates = 0, unattached = 0;
+	for (auto const &e : diagnostics.entries())
+	{
+		duplicates += e.level == 1 && e.text().find("duplicate dialog id") != std::string::npos;
+		unattached += e.text().find("cannot be attached") != std::string::npos;
+	}
+	CHECK(test, duplicates == 1);
+	CHECK(test, unattached == 1);
+}
+
+/**
+ * every dialog of a compiled tree is found by its id, whatever the order of the script
+ */
+static void testGraphFind()
+{
+	const char *test = "graph find";
+	Scripts scripts;
+	std::string a = scripts.add("a", "- $[m] first\n- $[c] second\n- $[x] third\n- $[a] fourth\n");
+
+	Engine engine;
+	engine.parseScriptFile(a);
+	auto graph = engine.graph(0);
+	CHECK(test, graph != nullptr);
+	CHECK(test, graph->dialogCount() == 4);
+	for (uint32_t i = 0; i < graph->dialogCount(); i++)
+		CHECK(test, graph->find(graph->dialogId(i)) == i);
+	CHECK(test, graph->find("b") == Graph::npos);
+	CHECK(test, graph->find("") == Graph::npos);
+	CHECK(test, graph->find("z") == Graph::npos);
+}
+
+/**
+ * reloading a lazy tree keeps the bytes of loaded graphs in step with the graphs
+ */
+static void testReloadLazy()
+{
+	const char *test = "reload lazy";
+	Scripts scripts;
+	std::string a = scripts.add("a", "- $[a1] first\n");
+
+	Engine engine;
+	engine.indexScriptFiles({a});
+	Session session = engine.start(a);
+	CHECK(test, !session.done());
+	CHECK(test, engine.residentBytes() == engine.graph(0)->image().size());
+
+	scripts.add("a", "- $[a1] first, now longer\n- $[a2] second\n");
+	Diagnostics diagnostics;
+	CHECK(test, engine.reloadScriptFile(a, diagnostics));
+	CHECK(test, engine.residentBytes() == engine.graph(0)->image().size());
+}
+
+/**
+ * a decision of a lazy tree that was unloaded, or never loaded, can be read and toggled from a session in another tree
+ */
+static void testToggleEvicted()
+{
+	const char *test = "toggle evicted";
+	Scripts scripts;
+	std::string a = scripts.add("a", "- $[a1] first\n+ $[a1 x] go $T[b]\n");
+	std::string b = scripts.add("b", "- $[b1] second\n+ $[b1 x] stay $d[b1]\n");
+	std::string c = scripts.add("c", "- $[c1] third\n+ $[c1 x] stay $d[c1]\n");
+
+	configure config;
+	config.load_budget = 1; // only trees with sessions in them stay loaded
+	Engine engine(config);
+	engine.indexScriptFiles({a, b, c});
+	engine.start(b);
+	Session session = engine.start(a);
+	CHECK(test, engine.graph(1) == nullptr);
+
+	uint32_t tb = engine.treeIndex(b), tc = engine.treeIndex(c);
+	CHECK(test, engine.enabled(session, tb, 0));
+	engine.enable(session, tb, 0, false);
+	CHECK(test, !engine.enabled(session, tb, 0));
+	CHECK(test, engine.enabled(session, tc, 0));
+	engine.enable(session, tc, 0, false);
+	CHECK(test, !engine.enabled(session, tc, 0));
+}
+
+/**
+ * an exhaustive run counts the same walks whatever the number of threads stealing from each other
+ */
+static void testExploreThreads()
+{
+	const char *test = "explore threads";
+	Scripts scripts;
+	std::string a = scripts.add("a", "- $[a1] loop\n+ $[a1 x] again $d[a1]\n+ $[a1 y] again $d[a1]\n+ $[a1 z] stop $d[a2]\n- $[a2] the end\n");
+
+	Engine engine;
+	engine.parseScriptFile(a);
+	RunStats one = engine.explore(a, 10, 1);
+	CHECK(test, one.walks == 2047);	  // 2^10 walks stopped on a loop, 2^10 - 1 walks stopping at a2
+	CHECK(test, one.finished == 511); // the walks stopping at a2 on the last step cannot end the game
+	for (unsigned threads : {2u, 4u, 8u})
+	{
+		RunStats many = engine.explore(a, 10, threads);
+		CHECK(test, many.walks == one.walks);
+		CHECK(test, many.steps == one.steps);
+		CHECK(test, many.finished == one.finished);
+	}
+}
+
+/**
+ * a script fed in chunks, cut anywhere, parses to the same tree and diagnostics as the whole script
+ */
+static void testStreamChunks()
+{
+	const char *test = "stream chunks";
+	const std::string script = "text before the first dialog\n"
+							   "- $[a1] first dialog\non two lines $t[b]\n"
+							   "+ $[a1 x] go on $d[a2]\n"
+							   "+ $[a1 y] a - and a + inside - a line\n"
+							   "+ $[a1 y] duplicate decision\n"
+							   "- $[a2] second dialog\n"
+							   "+ $[a2 x] back $d[a1]\n"
+							   "- $[a3] last dialog, no link\n";
+
+	// the script parsed in chunks of the given sizes, cycled through
+	auto parse = [&](std::vector<size_t> _sizes, std::string &_image, std::vector<std::string> &_diagnostics) {
+		Engine engine;
+		Diagnostics diagnostics;
+		Parser::Stream stream = engine.stream("s", diagnostics);
+		for (size_t at = 0, k = 0; at < script.size(); at += _sizes[k++ % _sizes.size()])
+			stream.feed(std::string_view(script).substr(at, _sizes[k % _sizes.size()]));
+		std::unique_ptr<Tree> tree(stream.finish());
+		_image = tree ? std::string(Graph(*tree).image()) : std::string();
+		_diagnostics.clear();
+		for (auto const &e : diagnostics.entries())
+			_diagnostics.push_back(e.text());
+	};
+
+	std::string whole, chunked;
+	std::vector<std::string> expected, reported;
+	parse({script.size()}, whole, expected);
+	CHECK(test, !whole.empty());
+	CHECK(test, expected.size() == 2); // the text before the first dialog and the duplicate decision
+	for (size_t size = 1; size < script.size(); size++)
+	{
+		parse({size}, chunked, reported);
+		CHECK(test, chunked == whole);
+		CHECK(test, reported == expected);
+	}
+	for (size_t cut = 1; cut < script.size(); cut++)
+	{
+		parse({cut, script.size()}, chunked, reported);
+		CHECK(test, chunked == whole);
+		CHECK(test, reported == expected);
+	}
+}
+
+/**
+ * a snapshot restores the dialog and toggled decisions of a session, also in another engine, and a damaged one throws
+ */
+static void testSaveRestore()
+{
+	const char *test = "save restore";
+	Scripts scripts;
+	std::string a = scripts.add("a", "- $[a1] first\n+ $[a1 x] on $d[a2]\n+ $[a1 y] away $T[b]\n- $[a2] second\n+ $[a2 x] back $d[a1]\n");
+	std::string b = scripts.add("b", "- $[b1] other\n+ $[b1 x] stay $d[b1]\n+ $[b1 y] leave $T[a]\n");
+
+	Engine engine;
+	engine.parseScriptFiles({a, b});
+	uint32_t ta = engine.treeIndex(a), tb = engine.treeIndex(b);
+	Session session = engine.start(a);
+	CHECK(test, engine.choose(session, 0));
+	engine.enable(session, tb, 1, false);
+	engine.enable(session, ta, 0, false);
+
+	std::string snapshot = engine.save(session);
+	Session restored = engine.restore(snapshot);
+	CHECK(test, restored.tree() == session.tree());
+	CHECK(test, restored.dialog() == session.dialog());
+	CHECK(test, !engine.enabled(restored, tb, 1));
+	CHECK(test, !engine.enabled(restored, ta, 0));
+	CHECK(test, engine.enabled(restored, tb, 0));
+	CHECK(test, engine.save(restored) == snapshot);
+
+	// trees are saved by id, another engine may number them differently
+	Engine other;
+	other.parseScriptFiles({b, a});
+	Session moved = other.restore(snapshot);
+	CHECK(test, moved.tree() == other.treeIndex(a));
+	CHECK(test, !moved.done() && other.graph(moved)->dialogId(moved.dialog()) == "a2");
+	CHECK(test, !other.enabled(moved, other.treeIndex(b), 1));
+	CHECK(test, other.enabled(moved, other.treeIndex(b), 0));
+
+	// a finished session stays finished
+	Session done;
+	CHECK(test, engine.restore(engine.save(done)).done());
+
+	auto throws = [&](const std::string &_snapshot) {
+		try
+		{
+			engine.restore(_snapshot);
+		}
+		catch (const exception &)
+		{
+			return true;
+		}
+		return false;
+	};
+	for (size_t size = 0; size < snapshot.size(); size++)
+		CHECK(test, throws(snapshot.substr(0, size)));
+	CHECK(test, throws(snapshot + '\0'));
+	std::string damaged = snapshot;
+	damaged[0] ^= 1;
+	CHECK(test, throws(damaged));
+	damaged = snapshot;
+	damaged[4] ^= 1; // version, after the magic
+	CHECK(test, throws(damaged));
+}
+
+/**
+ * a cached dialog follows the decisions a session toggled and the text of a reloaded tree
+ */
+static void testRenderCache()
+{
+	const char *test = "render cache";
+	Scripts scripts;
+	std::string a = scripts.add("a", "- $[a1] first\n+ $[a1 x] one $d[a1]\n+ $[a1 y] two $d[a1]\n");
+
+	configure config;
+	config.display_disabled_decisions = false;
+	Engine engine(config);
+	engine.parseScriptFile(a);
+	uint32_t ta = engine.treeIndex(a);
+	auto render = [&](const Session &_session) {
+		BufferSink sink;
+		Output output(&sink);
+		engine.render(_session, output);
+		return std::string(sink.data());
+	};
+
+	Session session = engine.start(a);
+	std::string all = render(session);
+	CHECK(test, all.find("one") != all.npos && all.find("two") != all.npos);
+	CHECK(test, render(session) == all);
+
+	engine.enable(session, ta, 1, false);
+	std::string hidden = render(session);
+	CHECK(test, hidden.find("one") != hidden.npos && hidden.find("two") == hidden.npos);
+	CHECK(test, render(engine.start(a)) == all);
+	engine.enable(session, ta, 1, true);
+	CHECK(test, render(session) == all);
+
+	scripts.add("a", "- $[a1] first, reloaded\n+ $[a1 x] uno $d[a1]\n+ $[a1 y] dos $d[a1]\n");
+	Diagnostics diagnostics;
+	CHECK(test, engine.reloadScriptFile(a, diagnostics));
+	std::string reloaded = render(engine.start(a));
+	CHECK(test, reloaded.find("reloaded") != reloaded.npos && reloaded.find("uno") != reloaded.npos && reloaded.find("one") == reloaded.npos);
+	CHECK(test, render(session) == all); // a session keeps its graph until its next step
+	CHECK(test, engine.choose(session, 0));
+	CHECK(test, render(session) == reloaded);
+}
+
+/**
+ * a relative tree link into a lazy tree that is not loaded cannot be stepped through at once
+ */
+static void testReadyRelative()
+{
+	const char *test = "ready relative";
+	Scripts scripts;
+	std::string a = scripts.add("story/a", "- $[a1] first\n+ $[a1 x] dot $T[./b]\n+ $[a1 y] plain $t[c]\n+ $[a1 z] loop $d[a1]\n");
+	std::string b = scripts.add("story/b", "- $[b1] second\n");
+	std::string c = scripts.add("story/c", "- $[c1] third\n");
+
+	Engine engine;
+	engine.indexScriptFiles({a, b, c});
+	Session session = engine.start(a);
+	CHECK(test, !session.done());
+	CHECK(test, !engine.ready(session, 0));
+	CHECK(test, !engine.ready(session, 1));
+	CHECK(test, engine.ready(session, 2));
+
+	std::vector<std::function<void()>> queued;
+	Engine::Step step = engine.step(session, 2, [&](std::function<void()> _task) { queued.push_back(std::move(_task)); });
+	CHECK(test, step.moved);
+	CHECK(test, step.loading.size() == 2);
+	for (auto &task : queued)
+		task();
+	CHECK(test, engine.ready(session, 0));
+	CHECK(test, engine.ready(session, 1));
+}
+
+/**
+ * a reloaded tree is searched in its new text, whether indexes are built on the first search or as trees are added
+ */
+static void testSearchReload()
+{
+	const char *test = "search reload";
+	for (bool eager : {false, true})
+	{
+		Scripts scripts;
+		std::string a = scripts.add("a", "- $[a1] The Dragon sleeps\n+ $[a1 x] wake the dragon $d[a2]\n- $[a2] fire\n");
+		std::string b = scripts.add("b", "- $[b1] no such beast\n");
+
+		configure config;
+		config.search_index = eager;
+		Engine engine(config);
+		engine.parseScriptFiles({a, b});
+		uint32_t ta = engine.treeIndex(a);
+
+		auto hits = engine.search("dragon");
+		CHECK(test, hits.size() == 2);
+		CHECK(test, hits.size() == 2 && hits[0].tree == ta && hits[0].decision == Graph::npos && hits[1].decision != Graph::npos);
+		CHECK(test, engine.search("beast").size() == 1);
+
+		scripts.add("a", "- $[a1] quiet\n+ $[a1 x] knock $d[a2]\n- $[a2] dragon fire, the dragon is awake\n");
+		Diagnostics diagnostics;
+		CHECK(test, engine.reloadScriptFile(a, diagnostics));
+		hits = engine.search("DRAGON");
+		CHECK(test, hits.size() == 1);
+		CHECK(test, hits.size() == 1 && hits[0].tree == ta && engine.graph(ta)->dialogId(hits[0].dialog) == "a2" && hits[0].decision == Graph::npos);
+		CHECK(test, engine.search("sleeps").empty());
+		CHECK(test, engine.search("knock").size() == 1);
+		CHECK(test, engine.search("beast").size() == 1);
+		hits = engine.searchId("a2");
+		CHECK(test, hits.size() == 1 && hits[0].tree == ta);
+	}
+}
+
+/**
+ * endings, walks and score ranges of acyclic stories, of loops repeated at will and of many trees linking to each other
+ */
+static void testOutcomes()
+{
+	const char *test = "outcomes";
+	Scripts scripts;
+	std::string dag = scripts.add("dag", "- $[a1] start\n+ $[a1 x] left $d[a2]\n+ $[a1 y] right $d[a3]\n"
+										 "- $[a2] left\n+ $[a2 x] on $d[a4]\n- $[a3] right\n+ $[a3 x] on $d[a4]\n- $[a4] the end\n");
+	std::string rising = scripts.add("rising", "- $[a1] start\n+ $[a1 x] again $d[a1]\n+ $[a1 y] stop $d[a2]\n- $[a2] the end\n");
+	std::string even = scripts.add("even", "- $[a1] start\n+ $[a1 x] there $d[a2]\n+ $[a1 y] stop $d[a3]\n"
+										   "- $[a2] there\n+ $[a2 x] back $d[a1]\n- $[a3] the end\n");
+	std::string falling = scripts.add("falling", "- $[a1] start\n+ $[a1 x] again $d[a1]\n+ $[a1 y] stop $d[a2]\n- $[a2] the end\n");
+
+	Engine engine;
+	engine.parseScriptFiles({dag, rising, even, falling});
+	auto score = [&](const std::string &_tree, const char *_dialog, const char *_decision, int _score) {
+		engine.tree().find(_tree)->second->dialog(_dialog)->decision(_decision)->score(_score);
+	};
+	score(dag, "a1", "a1 x", 1);
+	score(dag, "a1", "a1 y", 2);
+	score(dag, "a2", "a2 x", 10);
+	score(dag, "a3", "a3 x", -1);
+	score(rising, "a1", "a1 x", 3);
+	score(even, "a1", "a1 x", 5);
+	score(even, "a2", "a2 x", -5);
+	score(falling, "a1", "a1 x", -2);
+	for (auto const &t : {dag, rising, even, falling})
+		engine.compile(t);
+
+	std::vector<Engine::Outcome> outcomes = engine.outcomes();
+	const Engine::Outcome &o = outcomes[engine.treeIndex(dag)];
+	CHECK(test, o.endings == 1 && o.paths == 2 && o.minScore == 1 && o.maxScore == 11 && !o.unboundedMin && !o.unboundedMax);
+	const Engine::Outcome &r = outcomes[engine.treeIndex(rising)];
+	CHECK(test, r.endings == 1 && r.paths == Engine::Outcome::unbounded && r.minScore == 0 && !r.unboundedMin && r.unboundedMax);
+	const Engine::Outcome &e = outcomes[engine.treeIndex(even)];
+	CHECK(test, e.endings == 1 && e.paths == Engine::Outcome::unbounded && e.minScore == 0 && e.maxScore == 0 && !e.unboundedMin && !e.unboundedMax);
+	const Engine::Outcome &f = outcomes[engine.treeIndex(falling)];
+	CHECK(test, f.endings == 1 && f.paths == Engine::Outcome::unbounded && f.maxScore == 0 && f.unboundedMin && !f.unboundedMax);
+
+	// a chain of trees longer than 64, every tree reaches the ending of all the trees after it
+	Scripts chain;
+	std::vector<std::string> files;
+	const int length = 70;
+	for (int i = 0; i < length; i++)
+		files.push_back(chain.add("t" + std::to_string(i), "- $[d] tree\n+ $[d a] stop $d[e]\n" +
+															   (i + 1 < length ? "+ $[d b] next $T[t" + std::to_string(i + 1) + "]\n" : std::string()) + "- $[e] the end\n"));
+	Engine chained;
+	chained.parseScriptFiles(files);
+	outcomes = chained.outcomes(3);
+	for (int i = 0; i < length; i++)
+	{
+		const Engine::Outcome &c = outcomes[chained.treeIndex(files[i])];
+		CHECK(test, c.endings == uint64_t(length - i) && c.paths == uint64_t(length - i));
+	}
+}
+
+/**
+ * recorded steps come back unchanged from a replay log, also in another engine, and replay without a miss
+ */
+static void testReplayLog()
+{
+	const char *test = "replay log";
+	Scripts scripts;
+	std::string a = scripts.add("a", "- $[a1] first\n+ $[a1 x] on $d[a2]\n- $[a2] no decision\n- $[a3] third\n+ $[a3 x] back $d[a1]\n");
+	std::string b = scripts.add("b", "- $[b1] other\n+ $[b1 x] stay $d[b1]\n");
+
+	Engine engine;
+	engine.parseScriptFiles({a, b});
+	Recorder recorder;
+	engine.record(&recorder);
+	Session session = engine.start(a), other = engine.start(b);
+	CHECK(test, engine.choose(session, 0));
+	CHECK(test, engine.choose(other, 0));
+	CHECK(test, engine.next(session));
+	CHECK(test, engine.choose(session, 0));
+	CHECK(test, engine.choose(other, 0));
+	engine.record(nullptr);
+
+	std::vector<Record> records;
+	CHECK(test, recorder.drain(records) == 5);
+	CHECK(test, records.size() == 5 && records[2].session == session.id() && records[2].decision == Record::next);
+	std::string log;
+	engine.saveLog(records, log);
+
+	auto same = [](const Record &_a, const Record &_b) {
+		return _a.session == _b.session && _a.tree == _b.tree && _a.dialog == _b.dialog && _a.decision == _b.decision && _a.time == _b.time;
+	};
+	std::vector<Record> loaded = engine.loadLog(log);
+	CHECK(test, loaded.size() == records.size());
+	for (size_t i = 0; i < loaded.size() && i < records.size(); i++)
+		CHECK(test, same(loaded[i], records[i]));
+
+	// trees are found by id, another engine may number them differently
+	Engine replayed;
+	replayed.parseScriptFiles({b, a});
+	loaded = replayed.loadLog(log);
+	CHECK(test, loaded.size() == records.size());
+	for (size_t i = 0; i < loaded.size() && i < records.size(); i++)
+		CHECK(test, loaded[i].tree == replayed.treeIndex(records[i].tree == engine.treeIndex(a) ? a : b));
+	Engine::Playback playback = replayed.replay(loaded, 0, 2);
+	CHECK(test, playback.sessions == 2 && playback.steps == 5 && playback.missed == 0);
+
+	// the steps of a tree that is no longer in the story are missed
+	Engine alone;
+	alone.parseScriptFile(a);
+	playback = alone.replay(alone.loadLog(log));
+	CHECK(test, playback.steps == 3 && playback.missed == 2);
+
+	auto throws = [&](const std::string &_log) {
+		try
+		{
+			engine.loadLog(_log);
+		}
+		catch (const exception &)
+		{
+			return true;
+		}
+		return false;
+	};
+	for (size_t size = 1; size < log.size(); size++)
+		CHECK(test, throws(log.substr(0, size)));
+	CHECK(test, engine.loadLog(log + log).size() == 2 * records.size());
+}
+
+int main()
+{
+	console::level(1);
+	std::vector<std::pair<const char *, std::function<void()>>> tests = {
+		{"parse duplicate", testParseDuplicate},
+		{"duplicate dialog", testDuplicateDialog},
+		{"graph find", testGraphFind},
+		{"reload lazy", testReloadLazy},
+		{"toggle evicted", testToggleEvicted},
+		{"explore threads", testExploreThreads},
+		{"stream chunks", testStreamChunks},
+		{"save restore", testSaveRestore},
+		{"render cache", testRenderCache},
+		{"ready relative", testReadyRelative},
+		{"search reload", testSearchReload},
+		{"outcomes", testOutcomes},
+		{"replay log", testReplayLog},
+	};
+	for (auto const &t : tests)
+	{
+		try
+		{
+			t.second();
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << t.first << ": exception: " << e.what() << "\n";
+			failures++;
+		}
+	}
+	std::cout << tests.size() << " tests, " << failures << " failures\n";
+	return failures == 0 ? 0 : 1;
+}